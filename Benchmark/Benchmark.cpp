@@ -0,0 +1,377 @@
+/*--
+    Benchmark.cpp  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Runs a fixed corpus of strokes through every preset (and optionally through every algorithm and solver variant) and
+//reports the wall-clock time per stage and per stroke size, to catch performance regressions, and the distance of the
+//fits from the curves the strokes were generated from, to catch quality regressions.
+//Usage: Benchmark [--repeat N] [--threads N] [--variants] [--json FILE]
+
+#include "Fitter.h"
+#include "Parameters.h"
+#include "StrokeGenerator.h"
+#include "Algorithm.h"
+#include "Debugging.h"
+#include "Timer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+using namespace Eigen;
+using namespace Cornu;
+
+enum StrokeKind
+{
+    SMOOTH,
+    CORNERS,
+    CLOSED,
+    NUM_STROKE_KINDS
+};
+
+struct SizeBucket
+{
+    const char *name;
+    int numPoints;
+    int numCorners; //in the strokes with corners--small strokes get none, the pieces would be too short to fit
+};
+
+static const SizeBucket buckets[] = { { "small", 30, 0 }, { "medium", 100, 1 }, { "large", 400, 2 } };
+static const int numBuckets = sizeof(buckets) / sizeof(buckets[0]);
+static const int strokesPerKind = 6; //per bucket
+
+struct Stroke
+{
+    int bucket;
+    StrokeGenerator::Stroke stroke;
+};
+
+//The corpus is generated from a fixed seed, so it's the same on every platform and run.  Every preset must be able
+//to fit all of it, so there are no hooks: a clothoid-only fit can't follow them.
+static vector<Stroke> generateCorpus()
+{
+    vector<Stroke> out;
+    StrokeGenerator generator(12345);
+    StrokeGenerator::Options smooth;
+    smooth.hookProbability = 0.;
+
+    for(int b = 0; b < numBuckets; ++b)
+    {
+        StrokeGenerator::Options withCorners = smooth;
+        withCorners.numCorners = buckets[b].numCorners;
+
+        for(int k = 0; k < NUM_STROKE_KINDS; ++k)
+        {
+            if(k == CORNERS && withCorners.numCorners == 0)
+                continue;
+            generator.setOptions(k == CORNERS ? withCorners : smooth);
+            for(int i = 0; i < strokesPerKind; ++i)
+            {
+                Stroke stroke;
+                stroke.bucket = b;
+                stroke.stroke = (k == CLOSED) ? generator.closedStroke(buckets[b].numPoints) : generator.openStroke(buckets[b].numPoints);
+                out.push_back(stroke);
+            }
+        }
+    }
+
+    return out;
+}
+
+//the timings of one configuration, for all strokes of a bucket
+struct Samples
+{
+    Samples() : stages(NUM_ALGORITHM_STAGES), failures(0) {}
+
+    vector<double> total;
+    vector<vector<double> > stages;
+    vector<double> error; //of the fits, measured on the first repetition only
+    vector<double> solverIterations; //per fit, over all stages, on the first repetition only
+    int failures; //fits with no output
+};
+
+//the largest distance from the fit to the ground truth, in pixels
+static double fitError(PrimitiveSequenceConstPtr fit, PrimitiveSequenceConstPtr truth)
+{
+    double out = 0;
+    for(double s = 0; s < fit->length(); s += 1.)
+        out = max(out, truth->distanceTo(fit->pos(s)));
+    return out;
+}
+
+static double percentile(vector<double> values, double fraction)
+{
+    if(values.empty())
+        return 0.;
+    sort(values.begin(), values.end());
+    int idx = (int)ceil(fraction * values.size()) - 1;
+    return values[max(0, min((int)values.size() - 1, idx))];
+}
+
+static double sum(const vector<double> &values)
+{
+    double out = 0;
+    for(int i = 0; i < (int)values.size(); ++i)
+        out += values[i];
+    return out;
+}
+
+struct Configuration
+{
+    Configuration(const Parameters &inParams = Parameters()) : name(inParams.name()), params(inParams) {}
+
+    string name;
+    Parameters params;
+    vector<Samples> buckets; //the last one is for all strokes together
+};
+
+static void measure(Configuration &config, const vector<Stroke> &corpus, int repeat, int numThreads)
+{
+    config.buckets.assign(numBuckets + 1, Samples());
+
+    for(int r = 0; r < repeat; ++r)
+    {
+        for(int i = 0; i < (int)corpus.size(); ++i)
+        {
+            //a fresh fitter for each run, so no stage outputs are reused
+            Fitter fitter;
+            fitter.setDebugging(Debugging::silent());
+            fitter.setParams(config.params);
+            fitter.setNumThreads(numThreads);
+            fitter.setOriginalSketch(corpus[i].stroke.points);
+
+            Timer timer;
+            fitter.run();
+            double total = timer.elapsed();
+
+            Samples *samples[2] = { &config.buckets[corpus[i].bucket], &config.buckets[numBuckets] };
+            for(int j = 0; j < 2; ++j)
+            {
+                samples[j]->total.push_back(total);
+                for(int s = 0; s < NUM_ALGORITHM_STAGES; ++s)
+                    samples[j]->stages[s].push_back(fitter.stats().stageSeconds[s]);
+            }
+
+            if(r == 0)
+            {
+                PrimitiveSequenceConstPtr fit = fitter.finalOutput();
+                for(int j = 0; j < 2; ++j)
+                {
+                    samples[j]->solverIterations.push_back(fitter.stats().solverIterations);
+                    if(fit)
+                        samples[j]->error.push_back(fitError(fit, corpus[i].stroke.truth));
+                    else
+                        ++samples[j]->failures;
+                }
+            }
+        }
+    }
+}
+
+static string stageName(int stage)
+{
+    return AlgorithmBase::get(AlgorithmStage(stage), 0)->stageName();
+}
+
+static string bucketName(int bucket)
+{
+    return bucket < numBuckets ? buckets[bucket].name : "all";
+}
+
+static void printTable(const vector<Configuration> &configs)
+{
+    for(int c = 0; c < (int)configs.size(); ++c)
+    {
+        printf("\n%s\n", configs[c].name.c_str());
+        printf("  %-22s", "median / p99 (ms)");
+        for(int b = 0; b <= numBuckets; ++b)
+            printf("  %20s", bucketName(b).c_str());
+        printf("\n");
+
+        for(int s = 0; s <= NUM_ALGORITHM_STAGES; ++s)
+        {
+            printf("  %-22s", s < NUM_ALGORITHM_STAGES ? stageName(s).c_str() : "Total");
+            for(int b = 0; b <= numBuckets; ++b)
+            {
+                const Samples &samples = configs[c].buckets[b];
+                const vector<double> &values = s < NUM_ALGORITHM_STAGES ? samples.stages[s] : samples.total;
+                printf("  %9.3f / %8.3f", 1000. * percentile(values, 0.5), 1000. * percentile(values, 0.99));
+            }
+            printf("\n");
+        }
+
+        printf("  %-22s", "strokes per second");
+        for(int b = 0; b <= numBuckets; ++b)
+            printf("  %20.1f", configs[c].buckets[b].total.size() / max(1e-12, sum(configs[c].buckets[b].total)));
+        printf("\n");
+
+        printf("  %-22s", "fit error (px)");
+        for(int b = 0; b <= numBuckets; ++b)
+            printf("  %9.3f / %8.3f", percentile(configs[c].buckets[b].error, 0.5), percentile(configs[c].buckets[b].error, 0.99));
+        printf("\n");
+
+        printf("  %-22s", "solver iterations");
+        for(int b = 0; b <= numBuckets; ++b)
+            printf("  %9.0f / %8.0f", percentile(configs[c].buckets[b].solverIterations, 0.5), percentile(configs[c].buckets[b].solverIterations, 0.99));
+        printf("\n");
+
+        printf("  %-22s", "failed fits");
+        for(int b = 0; b <= numBuckets; ++b)
+            printf("  %20d", configs[c].buckets[b].failures);
+        printf("\n");
+    }
+}
+
+static void writeJSONPercentiles(FILE *file, const vector<double> &values)
+{
+    fprintf(file, "{ \"median\": %.9g, \"p99\": %.9g }", percentile(values, 0.5), percentile(values, 0.99));
+}
+
+static bool writeJSON(const char *fileName, const vector<Configuration> &configs, int repeat, int numThreads)
+{
+    FILE *file = fopen(fileName, "w");
+    if(!file)
+        return false;
+
+    fprintf(file, "{\n  \"repeat\": %d,\n  \"threads\": %d,\n  \"units\": \"seconds\",\n  \"configurations\": [\n", repeat, numThreads);
+    for(int c = 0; c < (int)configs.size(); ++c)
+    {
+        fprintf(file, "    {\n      \"name\": \"%s\",\n      \"buckets\": [\n", configs[c].name.c_str());
+        for(int b = 0; b <= numBuckets; ++b)
+        {
+            const Samples &samples = configs[c].buckets[b];
+            fprintf(file, "        {\n          \"name\": \"%s\",\n", bucketName(b).c_str());
+            if(b < numBuckets)
+                fprintf(file, "          \"points\": %d,\n", buckets[b].numPoints);
+            fprintf(file, "          \"strokes\": %d,\n", (int)samples.total.size());
+            fprintf(file, "          \"strokesPerSecond\": %.9g,\n", samples.total.size() / max(1e-12, sum(samples.total)));
+            fprintf(file, "          \"failures\": %d,\n", samples.failures);
+            fprintf(file, "          \"fitError\": ");
+            writeJSONPercentiles(file, samples.error);
+            fprintf(file, ",\n");
+            fprintf(file, "          \"solverIterations\": ");
+            writeJSONPercentiles(file, samples.solverIterations);
+            fprintf(file, ",\n");
+            fprintf(file, "          \"total\": ");
+            writeJSONPercentiles(file, samples.total);
+            fprintf(file, ",\n          \"stages\": {\n");
+            for(int s = 0; s < NUM_ALGORITHM_STAGES; ++s)
+            {
+                fprintf(file, "            \"%s\": ", stageName(s).c_str());
+                writeJSONPercentiles(file, samples.stages[s]);
+                fprintf(file, s + 1 < NUM_ALGORITHM_STAGES ? ",\n" : "\n");
+            }
+            fprintf(file, "          }\n        }%s\n", b < numBuckets ? "," : "");
+        }
+        fprintf(file, "      ]\n    }%s\n", c + 1 < (int)configs.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    int repeat = 3;
+    int numThreads = 1;
+    bool variants = false;
+    const char *jsonFile = NULL;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(!strcmp(argv[i], "--repeat") && i + 1 < argc)
+            repeat = max(1, atoi(argv[++i]));
+        else if(!strcmp(argv[i], "--threads") && i + 1 < argc)
+            numThreads = max(0, atoi(argv[++i]));
+        else if(!strcmp(argv[i], "--variants"))
+            variants = true;
+        else if(!strcmp(argv[i], "--json") && i + 1 < argc)
+            jsonFile = argv[++i];
+        else
+        {
+            printf("Usage: %s [--repeat N] [--threads N] [--variants] [--json FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    vector<Configuration> configs;
+    for(int i = 0; i < (int)Parameters::presets().size(); ++i)
+    {
+        configs.push_back(Configuration(Parameters::presets()[i]));
+    }
+
+    //each registered algorithm that isn't the default, swapped into the default parameters one stage at a time
+    if(variants)
+    {
+        for(int s = 0; s < NUM_ALGORITHM_STAGES; ++s)
+        {
+            for(int a = 0; a < AlgorithmBase::numAlgorithmsForStage(AlgorithmStage(s)); ++a)
+            {
+                Configuration config;
+                if(a == config.params.getAlgorithm(s))
+                    continue;
+                //it samples uniformly at the maximum sampling interval, which is too sparse for G2 fits of most of the corpus
+                if(s == RESAMPLING && AlgorithmBase::get(AlgorithmStage(s), a)->name() == "Length")
+                    continue;
+                config.params.setAlgorithm(s, a);
+                config.name = stageName(s) + ": " + AlgorithmBase::get(AlgorithmStage(s), a)->name();
+                configs.push_back(config);
+            }
+        }
+
+        //the trust region solver, with and without geodesic acceleration
+        for(int accelerate = 0; accelerate < 2; ++accelerate)
+        {
+            Configuration config;
+            config.params.set(Parameters::TRUST_REGION_SOLVER, 1.);
+            config.params.set(Parameters::GEODESIC_ACCELERATION, accelerate);
+            config.name = accelerate ? "Solver: Trust Region, Geodesic Acceleration" : "Solver: Trust Region";
+            configs.push_back(config);
+        }
+    }
+
+    vector<Stroke> corpus = generateCorpus();
+    printf("Fitting %d strokes %d times with %d configurations\n", (int)corpus.size(), repeat, (int)configs.size());
+
+    for(int c = 0; c < (int)configs.size(); ++c)
+        measure(configs[c], corpus, repeat, numThreads);
+
+    printTable(configs);
+
+    if(jsonFile && !writeJSON(jsonFile, configs, repeat, numThreads))
+    {
+        printf("Could not write %s\n", jsonFile);
+        return 1;
+    }
+
+    //a failed fit means the timings above don't cover the whole pipeline for that stroke
+    int failures = 0;
+    for(int c = 0; c < (int)configs.size(); ++c)
+        failures += configs[c].buckets[numBuckets].failures;
+    if(failures > 0)
+    {
+        printf("\n%d fits failed\n", failures);
+        return 1;
+    }
+
+    return 0;
+}
@@ -29,6 +29,7 @@
 #include "GraphConstructor.h"
 #include "PathFinder.h"
 #include "Combiner.h"
+#include "Threading.h"
 
 using namespace std;
 using namespace Eigen;
@@ -36,10 +37,11 @@ NAMESPACE_Cornu
 
 std::vector<std::vector<AlgorithmBase *> > AlgorithmBase::_algorithms(NUM_ALGORITHM_STAGES);
 bool AlgorithmBase::_initializationFinished = false;
+static OnceFlag algorithmsInitialized = CORNU_ONCE_INIT;
 
 const std::vector<std::vector<AlgorithmBase *> > &AlgorithmBase::_getAlgorithms()
 {
-    _initialize();
+    callOnce(algorithmsInitialized, &_initialize); //fitters on different threads may get here at the same time
     return _algorithms;
 }
 
@@ -53,6 +55,26 @@ void AlgorithmBase::_addAlgorithm(int stage, AlgorithmBase *algorithm)
     _algorithms[stage].push_back(algorithm);
 }
 
+class SingleStepTask : public AlgorithmTask
+{
+public:
+    SingleStepTask(AlgorithmBase *algorithm, const Fitter &fitter) : _algorithm(algorithm), _fitter(fitter) {}
+
+    //overrides
+    bool step() { _out = _algorithm->run(_fitter); return true; }
+    AlgorithmOutputBasePtr output() const { return _out; }
+
+private:
+    AlgorithmBase *_algorithm;
+    const Fitter &_fitter;
+    AlgorithmOutputBasePtr _out;
+};
+
+AlgorithmTaskPtr AlgorithmBase::startTask(const Fitter &fitter)
+{
+    return new SingleStepTask(this, fitter);
+}
+
 void AlgorithmBase::_initialize()
 {
     if(_initializationFinished)
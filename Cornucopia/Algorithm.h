@@ -23,6 +23,7 @@
 
 #include "defs.h"
 #include "smart_ptr.h"
+#include "Parameters.h"
 #include <vector>
 
 NAMESPACE_Cornu
@@ -66,12 +67,72 @@ class Algorithm
 {
 };
 
+//A run of an algorithm that can be done in several steps, for Fitter::step().  It keeps a reference to the fitter.
+class AlgorithmTask : public smart_base
+{
+public:
+    virtual bool step() = 0; //does a bounded amount of work and returns true once the output is complete
+    virtual AlgorithmOutputBasePtr output() const = 0;
+};
+
+CORNU_SMART_TYPEDEFS(AlgorithmTask);
+
+//Base for the tasks of algorithms that fill in their output over several steps
+template<int AlgStage>
+class AlgorithmTaskTemplate : public AlgorithmTask
+{
+public:
+    //override
+    AlgorithmOutputBasePtr output() const { return _out; }
+
+protected:
+    AlgorithmTaskTemplate(const Fitter &fitter, AlgorithmOutput<AlgStage> *out) : _fitter(fitter), _out(out) {}
+
+    const Fitter &_fitter;
+    smart_ptr<AlgorithmOutput<AlgStage> > _out;
+};
+
+//Says that an algorithm reads a parameter.  The fitter uses these to rerun only the stages affected by a parameter change.
+struct ParameterDependency
+{
+    enum Kind
+    {
+        VALUE, //any change to the value matters
+        FINITENESS, //only whether the value is less than Parameters::infinity matters
+        POSITIVITY //only whether the value is greater than zero matters
+    };
+
+    ParameterDependency(Parameters::ParameterType inParam, Kind inKind = VALUE) : param(inParam), kind(inKind) {}
+
+    bool changed(const Parameters &before, const Parameters &after) const
+    {
+        double b = before.get(param), a = after.get(param);
+        switch(kind)
+        {
+        case FINITENESS:
+            return (b < Parameters::infinity) != (a < Parameters::infinity);
+        case POSITIVITY:
+            return (b > 0.) != (a > 0.);
+        default:
+            return b != a;
+        }
+    }
+
+    Parameters::ParameterType param;
+    Kind kind;
+};
+
 class AlgorithmBase
 {
 public:
     virtual std::string name() const { return "Default"; }
     virtual std::string stageName() const = 0;
     virtual AlgorithmOutputBasePtr run(const Fitter &) = 0;
+    //Algorithms with long loops override this to split their work into steps; by default, the whole run is one step.
+    virtual AlgorithmTaskPtr startTask(const Fitter &fitter);
+    //Parameters read by this algorithm, including those read by functions it calls.  Fitter::scale() is
+    //taken care of by the fitter, but parameters read through Fitter::scaledParameter() must be listed.
+    virtual std::vector<ParameterDependency> dependencies() const { return std::vector<ParameterDependency>(); }
 
     static int numAlgorithmsForStage(AlgorithmStage stage) { return (int)_getAlgorithms()[stage].size(); }
     static AlgorithmBase *get(AlgorithmStage stage, int algorithm) { return _getAlgorithms()[stage][algorithm]; }
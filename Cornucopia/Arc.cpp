@@ -19,6 +19,7 @@
 */
 
 #include "Arc.h"
+#include "ProjectionKernels.h"
 
 using namespace std;
 using namespace Eigen;
@@ -83,6 +84,34 @@ void Arc::eval(double s, Vec *pos, Vec *der, Vec *der2) const
         (*der2) = Vec(-sina, cosa) * _params[CURVATURE];
 }
 
+void Arc::samplePositions(double from, double step, int count, Vec *out) const
+{
+    if(_flat)
+    {
+        for(int i = 0; i < count; ++i)
+            out[i] = _startPos() + _tangent * (from + i * step);
+        return;
+    }
+
+    //Rotate the vector from the center by the same angle for every sample.  It is recomputed exactly every so often
+    //so that roundoff doesn't build up.
+    const int anchorEvery = 64;
+    double stepAngle = step * _params[CURVATURE];
+    double cosStep = cos(stepAngle), sinStep = sin(stepAngle);
+    Vec fromCenter;
+    for(int i = 0; i < count; ++i)
+    {
+        if(i % anchorEvery == 0)
+        {
+            double angle = _startAngle() + (from + i * step) * _params[CURVATURE];
+            fromCenter = _radius * Vec(sin(angle), -cos(angle));
+        }
+        else
+            fromCenter = Vec(cosStep * fromCenter[0] - sinStep * fromCenter[1], sinStep * fromCenter[0] + cosStep * fromCenter[1]);
+        out[i] = _center + fromCenter;
+    }
+}
+
 double Arc::project(const Vec &point) const
 {
     double t;
@@ -110,6 +139,49 @@ double Arc::project(const Vec &point) const
     return max(0., min(_length(), t));
 }
 
+static LineKernelData flatKernelData(const Arc &arc)
+{
+    LineKernelData out = { arc.startPos()[0], arc.startPos()[1], cos(arc.startAngle()), sin(arc.startAngle()), arc.length() };
+    return out;
+}
+
+static ArcKernelData arcKernelData(const Arc &arc)
+{
+    ArcKernelData out;
+    out.cx = arc.center()[0];
+    out.cy = arc.center()[1];
+    out.radius = fabs(arc.radius());
+    Vector2d toMid = (arc.pos(0.5 * arc.length()) - arc.center()) / out.radius;
+    out.midX = toMid[0];
+    out.midY = toMid[1];
+    out.halfAngle = 0.5 * fabs(arc.length() * arc.curvature(0.));
+    out.cosHalfAngle = cos(min(PI, out.halfAngle));
+    out.turn = arc.curvature(0.) > 0. ? 1. : -1.;
+    Vector2d end = arc.endPos();
+    out.startX = arc.startPos()[0];
+    out.startY = arc.startPos()[1];
+    out.endX = end[0];
+    out.endY = end[1];
+    out.length = arc.length();
+    return out;
+}
+
+void Arc::projectMany(int n, const double *x, const double *y, double *outS) const
+{
+    if(_flat)
+        projectLineMany(flatKernelData(*this), n, x, y, outS);
+    else
+        projectArcMany(arcKernelData(*this), n, x, y, outS);
+}
+
+void Arc::distanceSqMany(int n, const double *x, const double *y, double *outDistSq) const
+{
+    if(_flat)
+        distanceSqLineMany(flatKernelData(*this), n, x, y, outDistSq);
+    else
+        distanceSqArcMany(arcKernelData(*this), n, x, y, outDistSq);
+}
+
 void Arc::trim(double sFrom, double sTo)
 {
     Vec newStart = pos(sFrom);
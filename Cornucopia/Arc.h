@@ -23,6 +23,7 @@
 
 #include "defs.h"
 #include "CurvePrimitive.h"
+#include "Pool.h"
 
 NAMESPACE_Cornu
 
@@ -37,8 +38,11 @@ public:
 
     //overrides
     void eval(double s, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const;
+    void samplePositions(double from, double step, int count, Vec *out) const;
 
     double project(const Vec &point) const;
+    void projectMany(int n, const double *x, const double *y, double *outS) const;
+    void distanceSqMany(int n, const double *x, const double *y, double *outDistSq) const;
 
     double angle(double s) const { return _startAngle() + s * _params[CURVATURE]; }
     double curvature(double s) const { return _params[CURVATURE]; }
@@ -59,7 +63,7 @@ public:
     Vec center() const { return _center; }
     double radius() const { return _radius; }
 
-    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    CORNU_POOLED_OPERATOR_NEW
 protected:
     //override
     void _paramsChanged();
@@ -22,6 +22,8 @@
 #include "Fresnel.h"
 #include "Eigen/LU"
 
+#include <complex>
+
 using namespace std;
 using namespace Eigen;
 NAMESPACE_Cornu
@@ -41,15 +43,25 @@ Clothoid::Clothoid(const Vec &start, double startAngle, double length, double cu
 
 void Clothoid::_paramsChanged()
 {
-    Vector2d startcs;
-
     _arc = fabs(_params[DCURVATURE]) < 1e-12;
-    _flat = false;
+    _flat = _arc && fabs(_params[CURVATURE]) < 1e-6;
+    _transformState = TRANSFORM_STALE;
+}
 
-    if(_arc)
+void Clothoid::_computeTransform() const
+{
+    if(!atomicCompareExchange(&_transformState, TRANSFORM_STALE, TRANSFORM_COMPUTING))
     {
-        _flat = fabs(_params[CURVATURE]) < 1e-6;
+        //another thread is computing it--this takes less time than blocking would
+        while(atomicLoadAcquire(&_transformState) != TRANSFORM_READY)
+            ;
+        return;
+    }
+
+    Vector2d startcs;
 
+    if(_arc)
+    {
         if(_flat)
         {
             _t1 = 0;
@@ -103,6 +115,9 @@ void Clothoid::_paramsChanged()
     }
 
     _startShift = _startPos() - _mat * startcs;    
+    _matInverse = _mat.inverse();
+
+    atomicStoreRelease(&_transformState, TRANSFORM_READY);
 }
 
 bool Clothoid::isValidImpl() const
@@ -116,6 +131,7 @@ void Clothoid::eval(double s, Vec *pos, Vec *der, Vec *der2) const
 {
     if(pos)
     {
+        _needTransform();
         double t = _t1 + s * _tdiff;
 
         Vector2d cs;
@@ -140,6 +156,60 @@ void Clothoid::eval(double s, Vec *pos, Vec *der, Vec *der2) const
     }
 }
 
+void Clothoid::samplePositions(double from, double step, int count, Vec *out) const
+{
+    //The step from one sample to the next is the integral of the tangent, (cos, sin) of a quadratic angle, which
+    //4-point Gauss-Legendre quadrature gets to about 1e-12 * step as long as the tangent turns by at most
+    //0.5 radians per step.  The angle at each quadrature point goes up by a linear amount from one step to the
+    //next, so the tangents are updated by two complex multiplications each instead of a sin and cos.  The position
+    //is recomputed exactly every so often so that roundoff doesn't build up.
+    double to = from + count * step;
+    double maxTurn = step * max(fabs(curvature(from)), fabs(curvature(to)));
+    if(count < 4 || maxTurn > 0.5)
+    {
+        CurvePrimitive::samplePositions(from, step, count, out);
+        return;
+    }
+
+    typedef complex<double> Complex;
+    const int numNodes = 4;
+    const double nodes[numNodes] = { -0.8611363115940526, -0.3399810435848563, 0.3399810435848563, 0.8611363115940526 };
+    const double weights[numNodes] = { 0.3478548451374538, 0.6521451548625461, 0.6521451548625461, 0.3478548451374538 };
+    const int anchorEvery = 64;
+
+    double dcurv = _params[DCURVATURE];
+    Complex stepTurnChange = polar(1., dcurv * step * step);
+    Complex tangents[numNodes], stepTurns[numNodes];
+
+    Vec cur = pos(from);
+    for(int i = 0; i < count; ++i)
+    {
+        if(i % anchorEvery == 0)
+        {
+            double s = from + i * step;
+            if(i > 0)
+                cur = pos(s);
+            for(int j = 0; j < numNodes; ++j)
+            {
+                double nodeS = s + 0.5 * step * (1. + nodes[j]);
+                tangents[j] = polar(1., angle(nodeS));
+                //angle(nodeS + step) - angle(nodeS)
+                stepTurns[j] = polar(1., step * (curvature(nodeS) + 0.5 * step * dcurv));
+            }
+        }
+        out[i] = cur;
+
+        Complex delta = 0.;
+        for(int j = 0; j < numNodes; ++j)
+        {
+            delta += weights[j] * tangents[j];
+            tangents[j] *= stepTurns[j];
+            stepTurns[j] *= stepTurnChange;
+        }
+        cur += (0.5 * step) * Vec(delta.real(), delta.imag());
+    }
+}
+
 double Clothoid::angle(double s) const
 {
     return _params[ANGLE] + s * (_params[CURVATURE] + 0.5 * s * _params[DCURVATURE]);
@@ -182,13 +252,45 @@ double Clothoid::project(const Vec &point) const
         return max(0., min(_length(), t));
     }
     //Go to the canonical clothoid
+    _needTransform();
     double endT = _t1 + _tdiff * _length();
-    Vec pt = _mat.inverse() * (point - _startShift);
+    Vec pt = _matInverse * (point - _startShift);
 
     double bestT = _clothoidProjector()->project(pt, min(_t1, endT), max(_t1, endT));
     return (bestT - _t1) / _tdiff;
 }
 
+void Clothoid::projectMany(int n, const double *x, const double *y, double *outS) const
+{
+    if(_arc)
+    {
+        CurvePrimitive::projectMany(n, x, y, outS);
+        return;
+    }
+
+    _needTransform();
+    double endT = _t1 + _tdiff * _length();
+    const int chunkSize = 32;
+    Vec pts[chunkSize];
+    for(int start = 0; start < n; start += chunkSize)
+    {
+        int count = min(chunkSize, n - start);
+        for(int i = 0; i < count; ++i)
+            pts[i] = _matInverse * (Vec(x[start + i], y[start + i]) - _startShift);
+
+        _clothoidProjector()->projectOrdered(count, pts, min(_t1, endT), max(_t1, endT), outS + start);
+        for(int i = 0; i < count; ++i)
+            outS[start + i] = (outS[start + i] - _t1) / _tdiff;
+    }
+}
+
+void Clothoid::distanceSqMany(int n, const double *x, const double *y, double *outDistSq) const
+{
+    projectMany(n, x, y, outDistSq);
+    for(int i = 0; i < n; ++i)
+        outDistSq[i] = (Vec(x[i], y[i]) - pos(outDistSq[i])).squaredNorm();
+}
+
 void Clothoid::trim(double sFrom, double sTo)
 {
     Vec newStart = pos(sFrom);
@@ -262,6 +364,7 @@ void Clothoid::derivativeAt(double s, ParamDer &out, ParamDer &outTan) const
         //dstartcs/dx = cossin(pi t1^2 / 2) * dt1/dx
         //dp/dx = dmat/dx * (cs - startcs) + mat * (dcs/dx - dstartcs/dx)
 
+        _needTransform();
         double t = _t1 + s * _tdiff;
         double scale = sqrt(fabs(1. / (PI * _params[DCURVATURE])));
         RowVector2d dt1dx(scale, -_params[CURVATURE] * scale / (2. * _params[DCURVATURE]));
@@ -23,6 +23,7 @@
 
 #include "defs.h"
 #include "CurvePrimitive.h"
+#include "Pool.h"
 
 NAMESPACE_Cornu
 
@@ -31,13 +32,16 @@ CORNU_SMART_FORW_DECL(Clothoid);
 class Clothoid : public CurvePrimitive
 {
 public:
-    Clothoid() {} //uninitialized
+    Clothoid() : _transformState(TRANSFORM_STALE) {} //uninitialized
     Clothoid(const Vec &start, double startAngle, double length, double curvature, double endCurvature);
 
     //overrides
     void eval(double s, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const;
+    void samplePositions(double from, double step, int count, Vec *out) const;
 
     double project(const Vec &point) const;
+    void projectMany(int n, const double *x, const double *y, double *outS) const; //fastest for points in order along the curve
+    void distanceSqMany(int n, const double *x, const double *y, double *outDistSq) const;
 
     double angle(double s) const;
     double curvature(double s) const;
@@ -59,24 +63,38 @@ public:
     {
     public:
         virtual double project(const Vec &pt, double from, double to) const = 0;
+        //projects points that are in order along the curve (like the samples of a stroke)
+        virtual void projectOrdered(int n, const Vec *pts, double from, double to, double *outT) const = 0;
     };
 
-    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    CORNU_POOLED_OPERATOR_NEW
 protected:
     //override
     void _paramsChanged();
     bool isValidImpl() const;
 
 private:
-    Vec _startShift; //translation component of transformation from canonical clothoid
-    Eigen::Matrix2d _mat; //rotation and scale component of transformation from canonical clothoid
-    double _t1; //start parameter on the canonical clothoid
-    double _tdiff;
+    void _needTransform() const { if(atomicLoadAcquire(&_transformState) != TRANSFORM_READY) _computeTransform(); }
+    void _computeTransform() const;
+
+    //The transformation from the canonical clothoid is computed when a position or a projection first needs it
+    //after the parameters change.  Solvers change the parameters on every step and often only look at angles and
+    //curvatures, which don't need the fresnel integrals.  A const clothoid may be shared between threads, so only
+    //the thread that moves the state from stale to computing writes the transformation, and it publishes it by
+    //storing the ready state with release semantics.
+    enum { TRANSFORM_STALE, TRANSFORM_COMPUTING, TRANSFORM_READY };
+    mutable Vec _startShift; //translation component of transformation from canonical clothoid
+    mutable Eigen::Matrix2d _mat; //rotation and scale component of transformation from canonical clothoid
+    mutable Eigen::Matrix2d _matInverse;
+    mutable double _t1; //start parameter on the canonical clothoid
+    mutable double _tdiff;
+    mutable volatile int _transformState;
     bool _arc;
     bool _flat;
 
     class _ClothoidProjectorImpl;
     static _ClothoidProjector *_clothoidProjector(); //projects onto a generic clothoid
+    static void _createClothoidProjector();
 };
 
 END_NAMESPACE_Cornu
@@ -19,30 +19,49 @@
 */
 
 #include "Clothoid.h"
-#include "Arc.h"
 #include "Fresnel.h"
+#include "Threading.h"
 
-#include <deque>
+#include <vector>
 
 using namespace std;
 using namespace Eigen;
 NAMESPACE_Cornu
 
-//an arc that approximates a part of a clothoid
+//an arc that approximates a part of a clothoid.  It is stored flat, without an Arc object,
+//so that making and testing one doesn't allocate.
 class _ApproxArc
 {
 public:
+    typedef Vector2d Vec;
+
+    _ApproxArc() {}
+
     _ApproxArc(double start, double length)
         : _start(start), _length(length)
     {
         //build an arc through three points on the clothoid to approximate it
-        Vector2d p[3];
+        Vec p[3];
         for(int i = 0; i < 3; ++i)
-            fresnelApprox(start + 0.5 * length * i, &(p[i][1]), &(p[i][0]));
-        _arc = new Arc(p[0], p[1], p[2]);
+            fresnelTable(start + 0.5 * length * i, &(p[i][1]), &(p[i][0]));
+
+        Vec a = p[1] - p[0], b = p[2] - p[0];
+        double cross = a[0] * b[1] - a[1] * b[0];
+        _center = p[0] + Vec(b[1] * a.squaredNorm() - a[1] * b.squaredNorm(), a[0] * b.squaredNorm() - b[0] * a.squaredNorm()) / (2. * cross);
+        _radius = (p[0] - _center).norm();
+
+        _dir = cross > 0. ? 1. : -1.;
+        _startAngle = _angle(p[0] - _center);
+        _sweep = 0.; //so that _relAngle measures from the start
+        _sweep = _relAngle(p[2] - _center);
     }
 
-    bool test(const Vector2d &pt, double &minDistSq, double &minT, double from, double to) const
+    const Vec &center() const { return _center; }
+    double radius() const { return _radius; }
+    double start() const { return _start; }
+    double end() const { return _start + _length; }
+
+    bool test(const Vec &pt, double &minDistSq, double &minT, double from, double to) const
     {
         //Do a quick-reject test:
         //Let r be the arc radius and let d be the distance from the point to the center.
@@ -50,56 +69,161 @@ public:
         //To avoid division and square roots (we don't have d, only d^2), we write this as:
         //((r^2 - d^2)/(r + d))^2 > minDistSq, or (r^2 - d^2)^2 > minDistSq (r + d)^2
         //Since (r + d)^2 < 2 * (r^2 + d^2), we can conservatively check (r^2 - d^2)^2 > 2 * minDistSq * (r^2 + d^2) 
-        double dSq = (pt - _arc->center()).squaredNorm();
-        double rSq = SQR(_arc->radius());
+        double dSq = (pt - _center).squaredNorm();
+        double rSq = SQR(_radius);
         if(SQR(dSq - rSq) > 2. * minDistSq * (dSq + rSq))
             return false;
 
         //Now really check
-        double t = _arc->project(pt);
-        t = min(max(t + _start, from), to) - _start;
+        double rel = _relAngle(pt - _center);
+        if(rel > _sweep) //past the end--go to the closer endpoint
+            rel = (rel - _sweep < TWOPI - rel) ? _sweep : 0.;
+        double t = min(max(_start + _length * rel / _sweep, from), to);
 
-        double distSq = (pt - _arc->pos(t)).squaredNorm();
+        double distSq = (pt - pos(t)).squaredNorm();
         if(distSq >= minDistSq)
             return false;
 
-        minT = _start + t;
+        minT = t;
         minDistSq = distSq;
         return true;
     }
 
+    Vec pos(double t) const
+    {
+        double angle = _startAngle + _dir * _sweep * (t - _start) / _length;
+        return _center + _radius * Vec(cos(angle), sin(angle));
+    }
+
+    //the range of distances from pt to the points of the arc
+    void distanceRange(const Vec &pt, double &outMin, double &outMax) const
+    {
+        outMin = outMax = (pos(end()) - pt).norm();
+        double startDist = (pos(_start) - pt).norm();
+        outMin = min(outMin, startDist);
+        outMax = max(outMax, startDist);
+
+        Vec toCenter = _center - pt;
+        double centerDist = toCenter.norm();
+        if(centerDist < 1e-12 * _radius)
+        {
+            outMin = outMax = _radius;
+            return;
+        }
+        if(_relAngle(toCenter) <= _sweep) //the point of the circle farthest from pt is on the arc
+            outMax = centerDist + _radius;
+        if(_relAngle(-toCenter) <= _sweep) //so is the closest point
+            outMin = fabs(centerDist - _radius);
+    }
+
 private:
-    ArcPtr _arc;
+    static double _angle(const Vec &v) { return atan2(v[1], v[0]); }
+
+    //angle of v from the start of the arc in the arc's direction, between 0 and 2pi
+    double _relAngle(const Vec &v) const
+    {
+        double rel = _dir * (_angle(v) - _startAngle);
+        rel -= TWOPI * floor(rel / TWOPI);
+        return (rel > _sweep && TWOPI - rel < 1e-12) ? 0. : rel;
+    }
+
+    Vec _center;
+    double _radius;
+    double _startAngle;
+    double _sweep; //unsigned angle spanned by the arc
+    double _dir; //1 for counterclockwise, -1 for clockwise
     double _start;
     double _length;
 };
 
+//a node of the bounding hierarchy over the approximating arcs: all of the arcs in the
+//node lie in an annulus around center and cover the parameter range from start to end
+struct _ArcNode
+{
+    Vector2d center;
+    double innerRadius;
+    double outerRadius;
+    double start;
+    double end;
+    int first; //index of the first child node, or -1 - (index of the arc) for a leaf
+};
+
 class Clothoid::_ClothoidProjectorImpl : public Clothoid::_ClothoidProjector
 {
 public:
     typedef Vector2d Vec;
 
     _ClothoidProjectorImpl() //initialize
-        : _arcSpacing(0.1)
+        : _arcSpacing(0.1), _maxArcParam(64.)
     {
-        double t;
-        for(t = 0; t * _arcSpacing < 0.9; t += _arcSpacing)
+        //Far from the inflection, the clothoid spirals around its limit points and arcs of length
+        //1/|t| approximate it well enough to start Newton's method from.
+        vector<_ApproxArc> posArcs;
+        for(double t = 0; t < _maxArcParam; )
         {
-            _arcs.push_front(_ApproxArc(-t - _arcSpacing, _arcSpacing));
-            _arcs.push_back(_ApproxArc(t, _arcSpacing));
+            double len = min(_arcSpacing, 1. / t);
+            posArcs.push_back(_ApproxArc(t, len));
+            t += len;
         }
-        _maxArcParam = t;
+        _maxArcParam = posArcs.back().end();
+        for(int i = (int)posArcs.size() - 1; i >= 0; --i)
+            _arcs.push_back(_ApproxArc(-posArcs[i].end(), posArcs[i].end() - posArcs[i].start()));
+        _arcs.insert(_arcs.end(), posArcs.begin(), posArcs.end());
+
+        _nodes.resize(1);
+        _buildNode(0, 0, (int)_arcs.size());
     }
 
     double project(const Vec &pt, double from, double to) const
     {
+        Vec startPt, endPt;
+        eval(from, &startPt);
+        eval(to, &endPt);
+
         double minT, minDistSq;
+        closerEnd(pt, from, to, startPt, endPt, minT, minDistSq);
+        scanArcs(pt, from, to, minT, minDistSq);
+
+        minT = projectNewton(minT, pt, from, to);
+        minT = projectNewton(minT, pt, from, to);
+        return minT;
+    }
+
+    void projectOrdered(int n, const Vec *pts, double from, double to, double *outT) const
+    {
+        Vec startPt, endPt;
+        eval(from, &startPt);
+        eval(to, &endPt);
 
-        Vector2d startPt, endPt;
-        fresnelApprox(from, &(startPt[1]), &(startPt[0]));
-        fresnelApprox(to, &(endPt[1]), &(endPt[0]));
+        for(int i = 0; i < n; ++i)
+        {
+            const Vec &pt = pts[i];
+
+            double minT, minDistSq;
+            closerEnd(pt, from, to, startPt, endPt, minT, minDistSq);
+
+            //Start Newton's method from the previous point's projection.  If it finds a closer point than the ends,
+            //the arcs farther than that point get rejected by the quick distance test, so few need projecting.
+            double warmT, warmDistSq;
+            bool warm = (i > 0 && projectFrom(outT[i - 1], pt, from, to, warmT, warmDistSq) && warmDistSq < minDistSq);
+            if(warm)
+            {
+                minT = warmT;
+                minDistSq = warmDistSq;
+            }
 
-        //test start and end points
+            if(scanArcs(pt, from, to, minT, minDistSq) || !warm)
+            {
+                minT = projectNewton(minT, pt, from, to);
+                minT = projectNewton(minT, pt, from, to);
+            } //otherwise the warm start is closest and has already converged
+            outT[i] = minT;
+        }
+    }
+
+private:
+    static void closerEnd(const Vec &pt, double from, double to, const Vec &startPt, const Vec &endPt, double &minT, double &minDistSq)
+    {
         minT = from;
         minDistSq = (pt - startPt).squaredNorm();
         double distSq = (pt - endPt).squaredNorm();
@@ -108,51 +232,155 @@ public:
             minDistSq = distSq;
             minT = to;
         }
+    }
 
-        //A possible optimization for clothoids outside the precomputed range is to batch
-        //the fresnel integral evaluations.  Not sure how much it'll help.
-        int minArcIdx = (int)floor((_maxArcParam + from) / _arcSpacing);
-        if(minArcIdx < 0)
+    //Looks for a point closer than minDistSq on the approximating arcs between from and to; returns true if it finds one
+    bool scanArcs(const Vec &pt, double from, double to, double &minT, double &minDistSq) const
+    {
+        bool found = false;
+
+        //the parts of the clothoid past the precomputed arcs get arcs made on the spot
+        double start = from;
+        double stop = min(to, -_maxArcParam);
+        int cnt = 0; //iteration count to prevent looping over a really spirally clothoid
+        while(start + 1e-8 < stop && ++cnt < 100)
         {
-            minArcIdx = 0;
-            //test against arcs before the precomputed ones
-            double start = from;
-            double stop = min(to, -_maxArcParam);
-            int cnt = 0; //iteration count to prevent looping over a really spirally clothoid
-            while(start + 1e-8 < stop && ++cnt < 100)
-            {
-                double len = min(stop - start, -1. / start);
-                _ApproxArc(start, len).test(pt, minDistSq, minT, from, to);
+            double len = min(stop - start, -1. / start);
+            found |= _ApproxArc(start, len).test(pt, minDistSq, minT, from, to);
 
-                start += len;
-            }
+            start += len;
         }
-        int maxArcIdx = (int)ceil((_maxArcParam + to) / _arcSpacing);
-        if(maxArcIdx > (int)_arcs.size())
+        start = to;
+        stop = max(_maxArcParam, from);
+        cnt = 0;
+        while(start - 1e-8 > stop && ++cnt < 100)
         {
-            maxArcIdx = (int)_arcs.size();
-            //test against arcs past the end of the precomputed ones
-            double start = to;
-            double stop = max(_maxArcParam, from);
-            int cnt = 0; //iteration count to prevent looping over a really spirally clothoid
-            while(start - 1e-8 > stop && ++cnt < 100)
-            {
-                double len = min(start - stop, 1. / start);
-                _ApproxArc(start - len, len).test(pt, minDistSq, minT, from, to);
+            double len = min(start - stop, 1. / start);
+            found |= _ApproxArc(start - len, len).test(pt, minDistSq, minT, from, to);
 
-                start -= len;
+            start -= len;
+        }
+
+        //depth-first search of the hierarchy, closer child first
+        int stack[64];
+        int stackSize = 0;
+        if(!_reject(_nodes[0], pt, from, to, minDistSq))
+            stack[stackSize++] = 0;
+        while(stackSize > 0)
+        {
+            const _ArcNode &node = _nodes[stack[--stackSize]];
+            if(node.first < 0)
+            {
+                found |= _arcs[-1 - node.first].test(pt, minDistSq, minT, from, to);
+                continue;
             }
+            if(_reject(node, pt, from, to, minDistSq)) //minDistSq may have gone down since it was pushed
+                continue;
+
+            int near = node.first, far = node.first + 1;
+            if(_lowerBound(_nodes[far], pt) < _lowerBound(_nodes[near], pt))
+                swap(near, far);
+            if(!_reject(_nodes[far], pt, from, to, minDistSq))
+                stack[stackSize++] = far;
+            if(!_reject(_nodes[near], pt, from, to, minDistSq))
+                stack[stackSize++] = near;
         }
 
-        for(int i = minArcIdx; i < maxArcIdx; ++i)
-            _arcs[i].test(pt, minDistSq, minT, from, to);
+        return found;
+    }
 
-        minT = projectNewton(minT, pt, from, to);
-        minT = projectNewton(minT, pt, from, to);
-        return minT;
+    //true if no arc of node between from and to can be closer than minDistSq to pt.  The annulus is
+    //tested the same way as an arc's circle in _ApproxArc::test
+    static bool _reject(const _ArcNode &node, const Vec &pt, double from, double to, double minDistSq)
+    {
+        if(node.end < from || node.start > to)
+            return true;
+        double dSq = (pt - node.center).squaredNorm();
+        double rSq;
+        if(dSq > SQR(node.outerRadius))
+            rSq = SQR(node.outerRadius);
+        else if(dSq < SQR(node.innerRadius))
+            rSq = SQR(node.innerRadius);
+        else
+            return false;
+        return SQR(dSq - rSq) > 2. * minDistSq * (dSq + rSq);
+    }
+
+    static double _lowerBound(const _ArcNode &node, const Vec &pt)
+    {
+        double d = (pt - node.center).norm();
+        return max(0., max(d - node.outerRadius, node.innerRadius - d));
+    }
+
+    //fills in the node for arcs from begin to end and its subtree
+    void _buildNode(int idx, int begin, int end)
+    {
+        _ArcNode node;
+        node.start = _arcs[begin].start();
+        node.end = _arcs[end - 1].end();
+        if(end - begin == 1)
+        {
+            node.center = _arcs[begin].center();
+            node.innerRadius = node.outerRadius = _arcs[begin].radius();
+            node.first = -1 - begin;
+            _nodes[idx] = node;
+            return;
+        }
+
+        //For a few turns of the spiral, the arc centers surround the limit point, so their
+        //average makes a tight annulus.
+        node.center = Vec::Zero();
+        for(int i = begin; i < end; ++i)
+            node.center += _arcs[i].center();
+        node.center /= double(end - begin);
+        _arcs[begin].distanceRange(node.center, node.innerRadius, node.outerRadius);
+        for(int i = begin + 1; i < end; ++i)
+        {
+            double minDist, maxDist;
+            _arcs[i].distanceRange(node.center, minDist, maxDist);
+            node.innerRadius = min(node.innerRadius, minDist);
+            node.outerRadius = max(node.outerRadius, maxDist);
+        }
+        //pad for roundoff
+        node.innerRadius *= (1. - 1e-9);
+        node.outerRadius *= (1. + 1e-9);
+
+        node.first = (int)_nodes.size();
+        _nodes.resize(_nodes.size() + 2);
+        _nodes[idx] = node;
+        int mid = (begin + end) / 2;
+        _buildNode(node.first, begin, mid);
+        _buildNode(node.first + 1, mid, end);
+    }
+
+    //Newton's method from a guess until it settles on a closest point inside the curve; returns false if it doesn't
+    bool projectFrom(double guess, const Vec &pt, double from, double to, double &outT, double &outDistSq) const
+    {
+        double t = guess;
+        for(int iter = 0; iter < 6; ++iter)
+        {
+            Vec p, der, der2;
+            eval(t, &p, &der, &der2);
+
+            double dot = der.dot(pt - p);
+            double dotDer = der2.dot(pt - p) - der.squaredNorm();
+            if(dotDer >= -1e-30) //not near a minimum of the distance
+                return false;
+
+            double next = t - dot / dotDer;
+            if(next <= from || next >= to) //the closest point may be an end, but that is for the full search to tell
+                return false;
+            if(fabs(next - t) < 1e-9 * max(1., fabs(t))) //convergence is quadratic, so this last step is as good as done
+            {
+                outT = next;
+                outDistSq = (pt - p).squaredNorm(); //the distance barely changes in the last step
+                return true;
+            }
+            t = next;
+        }
+        return false;
     }
 
-private:
     double projectNewton(double guess, const Vec &pt, double from, double to) const
     {
         Vec p, der, der2;
@@ -170,7 +398,7 @@ private:
     void eval(double t, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const
     {
         if(pos)
-            fresnelApprox(t, &((*pos)[1]), &((*pos)[0]));
+            fresnelTable(t, &((*pos)[1]), &((*pos)[0]));
         if(der || der2)
         {
             double s = sin(HALFPI * t * t), c = cos(HALFPI * t * t);
@@ -182,13 +410,22 @@ private:
     }
 
     const double _arcSpacing;
-    deque<_ApproxArc> _arcs;
     double _maxArcParam;
+    vector<_ApproxArc> _arcs; //in order of parameter
+    vector<_ArcNode> _nodes; //_nodes[0] is the root
 };
 
+static Clothoid::_ClothoidProjector *projector = NULL;
+static OnceFlag projectorInitialized = CORNU_ONCE_INIT;
+
+void Clothoid::_createClothoidProjector()
+{
+    projector = new _ClothoidProjectorImpl();
+}
+
 Clothoid::_ClothoidProjector *Clothoid::_clothoidProjector()
 {
-    static Clothoid::_ClothoidProjector *projector = new _ClothoidProjectorImpl();
+    callOnce(projectorInitialized, &_createClothoidProjector); //the projector is read-only once it's built
     return projector;
 }
 
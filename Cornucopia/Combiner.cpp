@@ -96,6 +96,8 @@ public:
         }
     }
 
+    double modelError(const Eigen::VectorXd &delta) const { return (_con + _conDer * delta).squaredNorm(); }
+
     //for derivative verification, combine error and constraints
     VectorXd errVec() const
     {
@@ -124,6 +126,11 @@ private:
     Eigen::MatrixXd _conDer;
 };
 
+//The constraint Jacobian is stored per junction: the continuity constraints between curves i and i + 1 only depend
+//on the parameters of those two curves.  The constraints are grouped so that group i has the constraints of
+//junction i and the box constraints on curve i (an open curve's last group also gets those on the last curve).
+//Only neighboring groups share curves, so the Schur complement of the KKT system is block tridiagonal (cyclic for
+//closed curves) and the solve takes time linear in the number of curves.
 class MulticurveSparseEvalData : public LSEvalData
 {
 public:
@@ -132,59 +139,78 @@ public:
     typedef LLT<BlockType> BlockCholType;
     typedef vector<BlockCholType, aligned_allocator<BlockCholType> > BlockCholVectorType;
 
+    struct Junction
+    {
+        MatrixXd left; //derivative with respect to the parameters of curve i
+        MatrixXd right; //derivative with respect to the parameters of curve i + 1
+    };
+
     //overrides
     double error() const { return _con.squaredNorm(); }
 
     void solveForDelta(double damping, Eigen::VectorXd &out, std::set<LSBoxConstraint> &constraints)
     {
         _computeIndices();
+        _computeGroups(constraints);
 
-        size_t vars = _blockIndices.back();
-        size_t cons = _con.size() + constraints.size();
+        int numBlocks = (int)_errDerBlocks.size();
+        int numGroups = (int)_groupBoxes.size();
+        bool closed = (int)_junctions.size() == numBlocks;
 
-        size_t size = vars + cons;
-        VectorXd rhs = VectorXd::Zero(size);
-        rhs.segment(0, vars) = _err;
-        rhs.segment(vars, _con.size()) = -_con;
-
-        BlockCholVectorType cholBlocks(_errDerBlocks.size());
-        for(size_t i = 0; i < cholBlocks.size(); ++i)
+        BlockCholVectorType cholBlocks(numBlocks);
+        for(int i = 0; i < numBlocks; ++i)
             cholBlocks[i] = BlockCholType(_errDerBlocks[i] + damping * MatrixXd::Identity(_blockSizes[i], _blockSizes[i]));
 
-        MatrixXd C = MatrixXd::Zero(cons, vars);
-        C.block(0, 0, _con.size(), vars) = _conDer;
+        //accumulate the Schur complement C H^-1 C^T one curve at a time
+        vector<MatrixXd> diagonal(numGroups), offDiagonal(closed ? numGroups : numGroups - 1);
+        for(int i = 0; i < numGroups; ++i)
+            diagonal[i] = MatrixXd::Zero(_groupOffsets[i + 1] - _groupOffsets[i], _groupOffsets[i + 1] - _groupOffsets[i]);
+        for(int i = 0; i < (int)offDiagonal.size(); ++i)
+            offDiagonal[i] = MatrixXd::Zero(diagonal[i].rows(), diagonal[(i + 1) % numGroups].rows());
 
-        int cnt = 0;
-        for(set<LSBoxConstraint>::const_iterator it = constraints.begin(); it != constraints.end(); ++it, ++cnt)
-            C(_conDer.rows() + cnt, it->index) = 1.;
+        for(int b = 0; b < numBlocks; ++b)
+        {
+            int groups[2] = { _prevGroup(b), _ownGroup(b) };
+            int numTouching = (groups[0] == groups[1]) ? 1 : 2;
+            if(numTouching == 1)
+                groups[0] = groups[1];
 
-        MatrixXd K(C.cols(), C.rows());
-        _solveCholL(K, cholBlocks, C.transpose());
-        LLT<MatrixXd> CholK(K.transpose() * K);
+            MatrixXd K[2];
+            for(int j = 0; j < numTouching; ++j)
+                K[j] = cholBlocks[b].matrixL().solve(_groupRowsOnBlock(groups[j], b).transpose());
 
-        VectorXd mid(size), result(size);
+            diagonal[groups[0]] += K[0].transpose() * K[0];
+            if(numTouching == 2)
+            {
+                diagonal[groups[1]] += K[1].transpose() * K[1];
+                offDiagonal[groups[0]] += K[0].transpose() * K[1]; //groups[1] follows groups[0]
+            }
+        }
 
-        //solve for mid
-        _solveCholL(mid.segment(0, vars), cholBlocks, rhs.segment(0, vars));
-        mid.segment(vars, cons) = CholK.matrixL().solve(rhs.segment(vars, cons) - K.adjoint() * mid.segment(0, vars));
+        BlockTridiagonalSolver schurSolver(diagonal, offDiagonal, closed);
 
-        //solve for result
-        result.segment(vars, cons) = -CholK.matrixU().solve(mid.segment(vars, cons));
-        _solveCholU(result.segment(0, vars), cholBlocks, mid.segment(0, vars) - K * result.segment(vars, cons));
+        //KKT system: H x + C^T l = g, C x = -c.  Eliminating x gives (C H^-1 C^T) l = C H^-1 g + c.
+        VectorXd hInvG(_blockIndices.back());
+        _solveBlocks(hInvG, cholBlocks, _err);
 
-        out = result.segment(0, vars);
+        VectorXd lambda = _applyC(hInvG);
+        for(int i = 0; i < (int)_junctions.size(); ++i)
+            lambda.segment(_groupOffsets[i], _junctions[i].left.rows()) += _con.segment(_conIndices[i], _junctions[i].left.rows());
+        lambda = schurSolver.solve(lambda);
+
+        out.resize(_blockIndices.back());
+        _solveBlocks(out, cholBlocks, _err - _applyCTranspose(lambda));
 #if 0
-        if(_conDer.size() > 0)
-            printf("Con Solve err = %lf\n", (_conDer * out + _con).norm());
+        printf("Con Solve err = %lf\n", (_applyC(out).head(_con.size()) + _con).norm());
 #endif
 
         //check which constraints we don't need
-        cnt = 0;
+        int cnt = 0;
         for(set<LSBoxConstraint>::iterator it = constraints.begin(); it != constraints.end(); ++cnt)
         {
             set<LSBoxConstraint>::iterator next = it;
             ++next;
-            if(result(vars + _conDer.rows() + cnt) * it->sign > 0)
+            if(lambda(_boxRows[cnt]) * it->sign > 0)
             {
                 //printf("Unsetting constraint on variable at index %d\n", it->index);
                 constraints.erase(it);
@@ -193,11 +219,24 @@ public:
         }
     }
 
+    double modelError(const Eigen::VectorXd &delta) const
+    {
+        double out = 0.;
+        for(int i = 0; i < (int)_junctions.size(); ++i)
+        {
+            const Junction &junction = _junctions[i];
+            int next = _nextBlock(i);
+            out += (_con.segment(_conIndices[i], junction.left.rows()) + junction.left * delta.segment(_blockIndices[i], _blockSizes[i]) +
+                    junction.right * delta.segment(_blockIndices[next], _blockSizes[next])).squaredNorm();
+        }
+        return out;
+    }
+
     VectorXd &errVectorRef() { return _err; }
     BlockVectorType &errDerBlocksRef() { return _errDerBlocks; }
 
     VectorXd &conVectorRef() { return _con; }
-    MatrixXd &conDerRef() { return _conDer; }
+    vector<Junction> &junctionsRef() { return _junctions; }
 
 private:
     void _computeIndices()
@@ -211,46 +250,126 @@ private:
             _blockSizes[i] = _errDerBlocks[i].rows();
             _blockIndices[i + 1] = _blockIndices[i] + _blockSizes[i];
         }
+
+        _conIndices.resize(_junctions.size() + 1);
+        _conIndices[0] = 0;
+        for(int i = 0; i < (int)_junctions.size(); ++i)
+            _conIndices[i + 1] = _conIndices[i] + _junctions[i].left.rows();
     }
 
-    MatrixXd _blocksToMatrix(const BlockVectorType &blocks)
+    //the constraint rows of each group are its junction's followed by its box constraints
+    void _computeGroups(const set<LSBoxConstraint> &constraints)
     {
-        size_t sz = _blockIndices.back();
-        MatrixXd out = MatrixXd::Zero(sz, sz);
+        int numGroups = (int)_junctions.size();
+        _groupBoxes.assign(numGroups, vector<pair<int, int> >());
+        _boxRows.clear();
+
+        vector<int> boxGroups; //group and position within the group of each box constraint, in order
+        for(set<LSBoxConstraint>::const_iterator it = constraints.begin(); it != constraints.end(); ++it)
+        {
+            int block = int(upper_bound(_blockIndices.begin(), _blockIndices.end(), (size_t)it->index) - _blockIndices.begin()) - 1;
+            int group = _ownGroup(block);
+            boxGroups.push_back(group);
+            _boxRows.push_back((int)_groupBoxes[group].size());
+            _groupBoxes[group].push_back(make_pair(block, it->index - (int)_blockIndices[block]));
+        }
 
-        for(int i = 0; i < (int)blocks.size(); ++i)
-            out.block(_blockIndices[i], _blockIndices[i], _blockSizes[i], _blockSizes[i]) = blocks[i];
+        _groupOffsets.resize(numGroups + 1);
+        _groupOffsets[0] = 0;
+        for(int i = 0; i < numGroups; ++i)
+            _groupOffsets[i + 1] = _groupOffsets[i] + (int)_junctions[i].left.rows() + (int)_groupBoxes[i].size();
 
+        for(int i = 0; i < (int)_boxRows.size(); ++i)
+            _boxRows[i] += _groupOffsets[boxGroups[i]] + (int)_junctions[boxGroups[i]].left.rows();
+    }
+
+    int _ownGroup(int block) const { return min(block, (int)_junctions.size() - 1); }
+    int _prevGroup(int block) const
+    {
+        if(block == 0)
+            return (int)_junctions.size() == (int)_blockSizes.size() ? (int)_junctions.size() - 1 : 0;
+        return block - 1;
+    }
+
+    int _nextBlock(int block) const { return (block + 1) % (int)_blockSizes.size(); }
+
+    //the rows of C belonging to a group, restricted to the columns of a block
+    MatrixXd _groupRowsOnBlock(int group, int block) const
+    {
+        const Junction &junction = _junctions[group];
+        int nCon = (int)junction.left.rows();
+        MatrixXd out = MatrixXd::Zero(nCon + _groupBoxes[group].size(), _blockSizes[block]);
+        if(group == block)
+            out.topRows(nCon) += junction.left;
+        if(_nextBlock(group) == block)
+            out.topRows(nCon) += junction.right;
+        for(int i = 0; i < (int)_groupBoxes[group].size(); ++i)
+        {
+            if(_groupBoxes[group][i].first == block)
+                out(nCon + i, _groupBoxes[group][i].second) = 1.;
+        }
         return out;
     }
 
-    template<class M1, class M2> void _solveCholL(const M1 &out, const BlockCholVectorType &chols, const M2 &rhs)
+    VectorXd _applyC(const VectorXd &x) const
     {
-        for(int i = 0; i < (int)chols.size(); ++i)
-            const_cast<M1 &>(out).block(_blockIndices[i], 0, _blockSizes[i], out.cols()) =
-                chols[i].matrixL().solve(rhs.block(_blockIndices[i], 0, _blockSizes[i], rhs.cols()));
+        VectorXd out(_groupOffsets.back());
+        for(int i = 0; i < (int)_junctions.size(); ++i)
+        {
+            const Junction &junction = _junctions[i];
+            int next = _nextBlock(i);
+            out.segment(_groupOffsets[i], junction.left.rows()) = junction.left * x.segment(_blockIndices[i], _blockSizes[i]) +
+                junction.right * x.segment(_blockIndices[next], _blockSizes[next]);
+
+            int boxStart = _groupOffsets[i] + (int)junction.left.rows();
+            for(int j = 0; j < (int)_groupBoxes[i].size(); ++j)
+                out[boxStart + j] = x[_blockIndices[_groupBoxes[i][j].first] + _groupBoxes[i][j].second];
+        }
+        return out;
     }
 
-    template<class M1, class M2> void _solveCholU(const M1 &out, const BlockCholVectorType &chols, const M2 &rhs)
+    VectorXd _applyCTranspose(const VectorXd &lambda) const
+    {
+        VectorXd out = VectorXd::Zero(_blockIndices.back());
+        for(int i = 0; i < (int)_junctions.size(); ++i)
+        {
+            const Junction &junction = _junctions[i];
+            int next = _nextBlock(i);
+            VectorXd l = lambda.segment(_groupOffsets[i], junction.left.rows());
+            out.segment(_blockIndices[i], _blockSizes[i]) += junction.left.transpose() * l;
+            out.segment(_blockIndices[next], _blockSizes[next]) += junction.right.transpose() * l;
+
+            int boxStart = _groupOffsets[i] + (int)junction.left.rows();
+            for(int j = 0; j < (int)_groupBoxes[i].size(); ++j)
+                out[_blockIndices[_groupBoxes[i][j].first] + _groupBoxes[i][j].second] += lambda[boxStart + j];
+        }
+        return out;
+    }
+
+    void _solveBlocks(VectorXd &out, const BlockCholVectorType &chols, const VectorXd &rhs) const
     {
         for(int i = 0; i < (int)chols.size(); ++i)
-            const_cast<M1 &>(out).block(_blockIndices[i], 0, _blockSizes[i], out.cols()) =
-                chols[i].matrixU().solve(rhs.block(_blockIndices[i], 0, _blockSizes[i], rhs.cols()));
+            out.segment(_blockIndices[i], _blockSizes[i]) = chols[i].solve(rhs.segment(_blockIndices[i], _blockSizes[i]));
     }
 
     vector<size_t> _blockIndices, _blockSizes;
     BlockVectorType _errDerBlocks;
 
+    vector<int> _conIndices; //of each junction's constraints in _con
+    vector<vector<pair<int, int> > > _groupBoxes; //block and index within the block of each group's box constraints
+    vector<int> _groupOffsets; //of each group's rows in the Schur complement
+    vector<int> _boxRows; //row in the Schur complement of each box constraint, in constraint order
+
     Eigen::VectorXd _err;
     Eigen::VectorXd _con;
-    Eigen::MatrixXd _conDer;
+    vector<Junction> _junctions;
 };
 
 class MulticurveProblem : public LSProblem
 {
 public:
     MulticurveProblem(const Fitter &fitter)
-        : _primitives(fitter.output<PRIMITIVE_FITTING>()->primitives), _iter(0)
+        : _primitives(fitter.output<PRIMITIVE_FITTING>()->primitives), _iter(0), _fitter(fitter)
     {
         smart_ptr<const AlgorithmOutput<GRAPH_CONSTRUCTION> > graph = fitter.output<GRAPH_CONSTRUCTION>();
         const vector<int> &path = fitter.output<PATH_FINDING>()->path;
@@ -380,6 +499,7 @@ public:
         _evalConstraints(evalData);
         //printf("Err: obj = %lf con = %lf\n", evalData->errVectorRef().norm(), evalData->conVectorRef().norm()); 
     }
+    bool cancelled() const { return _fitter.cancelled(); }
 
     void setParams(const Eigen::VectorXd &x)
     {
@@ -514,7 +634,6 @@ private:
     void _evalConstraints(EvalDataType *evalData)
     {
         VectorXd &outCon = evalData->conVectorRef();
-        MatrixXd &outConDer = evalData->conDerRef();
 
         vector<VectorXd> conVecs(_continuities.size());
         vector<MatrixXd> conVecDers(_continuities.size());
@@ -543,7 +662,13 @@ private:
             numVar += _curves.back()->numParams();
 
         outCon = VectorXd::Zero(numCon);
+#if SPARSE
+        vector<EvalDataType::Junction> &outJunctions = evalData->junctionsRef();
+        outJunctions.resize(_continuities.size());
+#else
+        MatrixXd &outConDer = evalData->conDerRef();
         outConDer = MatrixXd::Zero(numCon, numVar);
+#endif
 
         size_t curCon = 0, curVar = 0;
         for(int i = 0; i < (int)_continuities.size(); ++i)
@@ -551,6 +676,19 @@ private:
             size_t nCon = conVecs[i].size();
             size_t nVar = conVecDers[i].cols();
             outCon.segment(curCon, nCon) = conVecs[i];
+#if SPARSE
+            outJunctions[i].left = conVecDers[i];
+
+            //now the derivatives for the second curve
+            MatrixXd &right = outJunctions[i].right;
+            right = MatrixXd::Zero(nCon, _curves[i + 1]->numParams());
+            right(0, CurvePrimitive::X) = -1.;
+            right(1, CurvePrimitive::Y) = -1.;
+            if(nCon > 2)
+                right(2, CurvePrimitive::ANGLE) = -1.;
+            if(nCon > 3 && _curves[i + 1]->getType() != CurvePrimitive::LINE)
+                right(3, CurvePrimitive::CURVATURE) = -1.;
+#else
             outConDer.block(curCon, curVar, nCon, nVar) = conVecDers[i];
 
             //now the derivatives for the second curve
@@ -560,12 +698,14 @@ private:
                 outConDer(curCon + 2, (curVar + nVar + CurvePrimitive::ANGLE) % numVar) = -1.;
             if(nCon > 3 && _curves[i + 1]->getType() != CurvePrimitive::LINE)
                 outConDer(curCon + 3, (curVar + nVar + CurvePrimitive::CURVATURE) % numVar) = -1.;
+#endif
 
             curCon += nCon;
             curVar += nVar;
         }
     }
 
+    const Fitter &_fitter;
     VectorC<CurvePrimitivePtr> _curves;
     const vector<FitPrimitive> &_primitives;
     vector<int> _primIdcs;
@@ -581,6 +721,17 @@ class DefaultCombiner : public Algorithm<COMBINING>
 public:
     string name() const { return "Default"; }
 
+    //override
+    vector<ParameterDependency> dependencies() const
+    {
+        vector<ParameterDependency> out;
+        out.push_back(ParameterDependency(Parameters::COMBINE_DAMPING));
+        out.push_back(ParameterDependency(Parameters::TRUST_REGION_SOLVER));
+        out.push_back(ParameterDependency(Parameters::GEODESIC_ACCELERATION));
+        out.push_back(ParameterDependency(Parameters::INFLECTION_COST, ParameterDependency::POSITIVITY));
+        return out;
+    }
+
 protected:
     void _run(const Fitter &fitter, AlgorithmOutput<COMBINING> &out)
     {
@@ -609,9 +760,14 @@ protected:
             solver.setMaxIter(50);
             solver.setIncreaseDampingAfter(5);
             solver.setDampingIncreaseFactor(1.5);
+            solver.setTrustRegion(fitter.params().get(Parameters::TRUST_REGION_SOLVER) != 0.);
+            solver.setGeodesicAcceleration(fitter.params().get(Parameters::GEODESIC_ACCELERATION) != 0.);
 
             VectorXd result = solver.solve(problem.params());
             problem.setParams(result);
+            fitter.runningStats().solverIterations += solver.iterations();
+            fitter.runningStats().solverHalvings += solver.halvings();
+            fitter.runningStats().solverRejections += solver.rejections();
             Debugging::get()->printf("Final objective = %lf", sqrt(problem.objective()));
 
             outV = problem.curves();
@@ -33,6 +33,15 @@ class BaseCornerDetector : public Algorithm<CORNER_DETECTION>
 public:
     string name() const { return "Default"; }
 
+    //override
+    vector<ParameterDependency> dependencies() const
+    {
+        vector<ParameterDependency> out;
+        out.push_back(ParameterDependency(Parameters::MINIMUM_CORNER_SPACING));
+        out.push_back(ParameterDependency(Parameters::CORNER_THRESHOLD));
+        return out;
+    }
+
 protected:
     void _run(const Fitter &fitter, AlgorithmOutput<CORNER_DETECTION> &out)
     {
@@ -86,6 +95,17 @@ protected:
 
 class DefaultCornerDetector : public BaseCornerDetector
 {
+public:
+    //override
+    vector<ParameterDependency> dependencies() const
+    {
+        vector<ParameterDependency> out = BaseCornerDetector::dependencies();
+        out.push_back(ParameterDependency(Parameters::CORNER_NEIGHBORHOOD));
+        out.push_back(ParameterDependency(Parameters::DENSE_SAMPLING_STEP));
+        out.push_back(ParameterDependency(Parameters::CORNER_SCALES));
+        return out;
+    }
+
 protected:
     virtual VectorC<double> cornerScores(const Fitter &fitter)
     {
@@ -24,6 +24,7 @@
 //This file just collects the includes necessary to use Cornucopia fully
 //For a minimalistic API, see SimpleAPI.h
 #include "Fitter.h"
+#include "IncrementalFitter.h"
 #include "Polyline.h"
 #include "PrimitiveSequence.h"
 #include "Line.h"
@@ -47,6 +47,37 @@ public:
     virtual double distanceSqTo(const Vec &point) const { return (point - pos(project(point))).squaredNorm(); }
     virtual double distanceTo(const Vec &point) const { return sqrt(distanceSqTo(point)); }
 
+    //project and distanceSqTo for n points, given by separate arrays of coordinates--subclasses can implement them
+    //more efficiently
+    virtual void projectMany(int n, const double *x, const double *y, double *outS) const
+    {
+        for(int i = 0; i < n; ++i)
+            outS[i] = project(Vec(x[i], y[i]));
+    }
+    virtual void distanceSqMany(int n, const double *x, const double *y, double *outDistSq) const
+    {
+        for(int i = 0; i < n; ++i)
+            outDistSq[i] = distanceSqTo(Vec(x[i], y[i]));
+    }
+
+    //Writes the positions at count values of s, step apart starting at from--subclasses can compute them faster
+    //than one at a time
+    virtual void samplePositions(double from, double step, int count, Vec *out) const
+    {
+        for(int i = 0; i < count; ++i)
+            out[i] = pos(from + i * step);
+    }
+    //Writes the positions at s = 0, step, 2 * step, ... up to length(), numUniformSamples(step) of them, for drawing.
+    //step must be positive (otherwise there is just the one sample at s = 0).
+    void sampleUniform(double step, Vec *out) const { samplePositions(0., step, numUniformSamples(step), out); }
+    int numUniformSamples(double step) const
+    {
+        assert(step > 0.);
+        if(!(step > 0.))
+            return 1;
+        return (int)floor(length() / step + 1e-9) + 1;
+    }
+
     //derived evaluation functions--subclasses can implement them more efficiently
     virtual Vec pos(double s) const { Vec out; eval(s, &out); return out; }
     virtual Vec der(double s) const { Vec out; eval(s, NULL, &out); return out; }
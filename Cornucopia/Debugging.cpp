@@ -26,6 +26,13 @@ using namespace Eigen;
 NAMESPACE_Cornu
 
 Debugging *Debugging::_currentDebugging = new Debugging();
+CORNU_THREAD_LOCAL Debugging *Debugging::_threadDebugging = NULL;
+
+Debugging *Debugging::silent()
+{
+    static Debugging silentDebugging; //has no state, so it can be shared by all threads
+    return &silentDebugging;
+}
 
 void Debugging::set(Debugging *debugging)
 {
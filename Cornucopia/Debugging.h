@@ -46,7 +46,21 @@ public:
         DOTTED
     };
 
-    static Debugging *get() { return _currentDebugging; }
+    //returns the debugging object for the calling thread if one is set (see ThreadScope), the global one otherwise
+    static Debugging *get() { return _threadDebugging ? _threadDebugging : _currentDebugging; }
+    //returns a debugging object that ignores everything--useful for fitting on worker threads
+    static Debugging *silent();
+
+    //While this object exists, get() on the current thread returns the given debugging object.
+    //Passing NULL leaves the current one in place.
+    class ThreadScope
+    {
+    public:
+        ThreadScope(Debugging *debugging) : _prev(_threadDebugging) { if(debugging) _threadDebugging = debugging; }
+        ~ThreadScope() { _threadDebugging = _prev; }
+    private:
+        Debugging *_prev;
+    };
 
     virtual ~Debugging() {}
 
@@ -74,6 +88,7 @@ protected:
 
 private:
     static Debugging *_currentDebugging;
+    static CORNU_THREAD_LOCAL Debugging *_threadDebugging;
 };
 
 END_NAMESPACE_Cornu
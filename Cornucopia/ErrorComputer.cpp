@@ -23,11 +23,35 @@
 #include "Fitter.h"
 #include "Polyline.h"
 #include "CurvePrimitive.h"
+#include "PrimitiveFitUtils.h"
 
 using namespace std;
 using namespace Eigen;
 NAMESPACE_Cornu
 
+//Reuses nothing between calls
+class DefaultErrorTracker : public ErrorTracker
+{
+public:
+    DefaultErrorTracker(ErrorComputerConstPtr errorComputer, int from)
+        : _errorComputer(errorComputer), _from(from) {}
+
+    //override
+    double computeErrorForCostBounded(CurvePrimitiveConstPtr curve, int to, double bound)
+    {
+        return _errorComputer->computeErrorForCostBounded(curve, _from, to, bound);
+    }
+
+private:
+    ErrorComputerConstPtr _errorComputer;
+    int _from;
+};
+
+ErrorTrackerPtr ErrorComputer::tracker(int from) const
+{
+    return new DefaultErrorTracker(this, from);
+}
+
 class L2ErrorComputer : public ErrorComputer
 {
 public:
@@ -41,9 +65,14 @@ public:
         _weightLeftRoots = VectorC<double>(_pts.size(), circular);
         _weightRightRoots = VectorC<double>(_pts.size(), circular);
         _weightRoots = VectorC<double>(_pts.size(), circular);
+        _x.resize(_pts.size());
+        _y.resize(_pts.size());
 
         for(int i = 0; i < _pts.size(); ++i)
         {
+            _x[i] = _pts[i][0];
+            _y[i] = _pts[i][1];
+
             VectorC<Vector2d>::Circulator prev = --_pts.circulator(i);
             VectorC<Vector2d>::Circulator next = ++_pts.circulator(i);
             _weightsLeft[i] = prev.done() ? 0 : poly->lengthFromTo(prev.index(), i);
@@ -57,45 +86,7 @@ public:
     double computeError(CurvePrimitiveConstPtr curve, int from, int to,
                         bool firstToEndpoint, bool lastToEndpoint, bool reversed) const
     {
-        double error = 0;
-
-        if(from < 0 || to >= (int)_pts.size())
-            return 0.;
-
-        bool first = true;
-        for(VectorC<Vector2d>::Circulator circ = _pts.circulator(from); ; ++circ)
-        {
-            int idx = circ.index();
-            bool last = (idx == to);
-
-            bool toFirstEndpoint = first && firstToEndpoint;
-            bool toLastEndpoint = last && lastToEndpoint;
-
-            const Vector2d &pt = _pts.flatAt(idx);
-
-            double s;
-            if(toLastEndpoint)
-                s = reversed ? 0 : curve->length();
-            else if(toFirstEndpoint)
-                s = reversed ? curve->length() : 0;
-            else
-                s = curve->project(pt);
-
-            double distSq = (curve->pos(s) - pt).squaredNorm();
-            double weight = 0;
-            if(!toFirstEndpoint)
-                weight += _weightsLeft.flatAt(idx);
-            if(!toLastEndpoint)
-                weight += _weightsRight.flatAt(idx);
-
-            error += weight * distSq;
-
-            first = false;
-            if(last)
-                break;
-        }
-
-        return error;
+        return _computeError(curve, from, to, Parameters::infinity, firstToEndpoint, lastToEndpoint, reversed);
     }
 
     void computeErrorVector(CurvePrimitiveConstPtr curve, int from, int to, VectorXd &outError, MatrixXd *outErrorDer,
@@ -115,6 +106,8 @@ public:
         }
          
         CurvePrimitive::ParamDer der, tanDer;
+        double chunkS[chunkSize];
+        int chunkStart = 0, chunkCount = 0;
         bool first = true;
         int vecIdx = 0;
         for(VectorC<Vector2d>::Circulator circ = _pts.circulator(from); ; ++circ, vecIdx += 2)
@@ -140,7 +133,11 @@ public:
             else if(toFirstEndpoint)
                 s = reversed ? curve->length() : 0;
             else
-                s = curve->project(pt);
+            {
+                if(!_inChunk(idx, chunkStart, chunkCount))
+                    _nextChunk(*curve, idx, to, chunkStart, chunkCount, NULL, chunkS);
+                s = chunkS[idx - chunkStart];
+            }
 
             Vector2d err = curve->pos(s) - pt;
             outError.segment<2>(vecIdx) = err * weightRoot;
@@ -178,8 +175,86 @@ public:
         return computeError(curve, from, to, firstToEndpoint, lastToEndpoint, reversed) / curve->length();
     }
 
+    double computeErrorForCostBounded(CurvePrimitiveConstPtr curve, int from, int to, double bound,
+                                      bool firstToEndpoint, bool lastToEndpoint, bool reversed) const
+    {
+        double length = curve->length();
+        //the slack keeps the rounding of bound * length from cutting off a cost that is exactly at the bound
+        return _computeError(curve, from, to, bound * length * (1. + 1e-9), firstToEndpoint, lastToEndpoint, reversed) / length;
+    }
+
 protected:
+    //The samples are projected in batches of up to this many
+    static const int chunkSize = 32;
+
+    static bool _inChunk(int idx, int chunkStart, int chunkCount) { return idx >= chunkStart && idx < chunkStart + chunkCount; }
+
+    //Projects the samples from idx on (up to to, incl., and not past the end of the array) onto the curve, writing
+    //the squared distances or the parameters
+    void _nextChunk(const CurvePrimitive &curve, int idx, int to, int &chunkStart, int &chunkCount, double *outDistSq, double *outS) const
+    {
+        chunkStart = idx;
+        chunkCount = min(chunkSize, (idx <= to ? to + 1 : (int)_pts.size()) - idx);
+        if(outDistSq)
+            curve.distanceSqMany(chunkCount, &_x[idx], &_y[idx], outDistSq);
+        if(outS)
+            curve.projectMany(chunkCount, &_x[idx], &_y[idx], outS);
+    }
+
+    //The summed error, except that as soon as the partial sum exceeds maxError, gives up and returns infinity
+    double _computeError(CurvePrimitiveConstPtr curve, int from, int to, double maxError,
+                         bool firstToEndpoint, bool lastToEndpoint, bool reversed) const
+    {
+        double error = 0;
+
+        if(from < 0 || to >= (int)_pts.size())
+            return 0.;
+
+        double chunkDistSq[chunkSize];
+        int chunkStart = 0, chunkCount = 0;
+        bool first = true;
+        for(VectorC<Vector2d>::Circulator circ = _pts.circulator(from); ; ++circ)
+        {
+            int idx = circ.index();
+            bool last = (idx == to);
+
+            bool toFirstEndpoint = first && firstToEndpoint;
+            bool toLastEndpoint = last && lastToEndpoint;
+
+            const Vector2d &pt = _pts.flatAt(idx);
+
+            double distSq;
+            if(toLastEndpoint)
+                distSq = (curve->pos(reversed ? 0 : curve->length()) - pt).squaredNorm();
+            else if(toFirstEndpoint)
+                distSq = (curve->pos(reversed ? curve->length() : 0) - pt).squaredNorm();
+            else
+            {
+                if(!_inChunk(idx, chunkStart, chunkCount))
+                    _nextChunk(*curve, idx, to, chunkStart, chunkCount, chunkDistSq, NULL);
+                distSq = chunkDistSq[idx - chunkStart];
+            }
+
+            double weight = 0;
+            if(!toFirstEndpoint)
+                weight += _weightsLeft.flatAt(idx);
+            if(!toLastEndpoint)
+                weight += _weightsRight.flatAt(idx);
+
+            error += weight * distSq;
+            if(error > maxError)
+                return Parameters::infinity;
+
+            first = false;
+            if(last)
+                break;
+        }
+
+        return error;
+    }
+
     const VectorC<Vector2d> &_pts;
+    vector<double> _x, _y; //the coordinates of _pts, for the batch projections
     VectorC<double> _weightsLeft, _weightsRight, _weightLeftRoots, _weightRightRoots, _weightRoots;
 };
 
@@ -191,12 +266,20 @@ public:
 
     double computeErrorForCost(CurvePrimitiveConstPtr curve, int from, int to,
                                bool firstToEndpoint, bool lastToEndpoint, bool reversed) const
+    {
+        return computeErrorForCostBounded(curve, from, to, Parameters::infinity, firstToEndpoint, lastToEndpoint, reversed);
+    }
+
+    double computeErrorForCostBounded(CurvePrimitiveConstPtr curve, int from, int to, double bound,
+                                      bool firstToEndpoint, bool lastToEndpoint, bool reversed) const
     {
         double error = 0;
 
         if(from < 0 || to >= (int)_pts.size())
             return 0.;
 
+        double chunkDistSq[chunkSize];
+        int chunkStart = 0, chunkCount = 0;
         bool first = true;
         for(VectorC<Vector2d>::Circulator circ = _pts.circulator(from); ; ++circ)
         {
@@ -208,17 +291,21 @@ public:
 
             const Vector2d &pt = _pts.flatAt(idx);
 
-            double s;
+            double distSq;
             if(toLastEndpoint)
-                s = reversed ? 0 : curve->length();
+                distSq = (curve->pos(reversed ? 0 : curve->length()) - pt).squaredNorm();
             else if(toFirstEndpoint)
-                s = reversed ? curve->length() : 0;
+                distSq = (curve->pos(reversed ? curve->length() : 0) - pt).squaredNorm();
             else
-                s = curve->project(pt);
-
-            double distSq = (curve->pos(s) - pt).squaredNorm();
+            {
+                if(!_inChunk(idx, chunkStart, chunkCount))
+                    _nextChunk(*curve, idx, to, chunkStart, chunkCount, chunkDistSq, NULL);
+                distSq = chunkDistSq[idx - chunkStart];
+            }
 
             error = max(error, distSq);
+            if(error > bound) //no later point can bring the maximum back down
+                return error;
 
             first = false;
             if(last)
@@ -227,29 +314,201 @@ public:
 
         return error;
     }    
+
+    //override
+    ErrorTrackerPtr tracker(int from) const;
+};
+
+//Keeps an upper bound on the distance from every sample in the span to the last curve.  A new curve is within
+//_perturbation() of the previous one, so the bounds grow by that much and only the samples whose bound could exceed
+//the maximum found so far are projected again.  This only pays off for arcs: projecting onto a line is as cheap as
+//checking the bound, and projections onto clothoids are numerical and not exact enough for the bounds to hold.
+//Short spans are evaluated in full too, because each added sample changes their fit too much to skip anything.
+class LInfErrorTracker : public ErrorTracker
+{
+public:
+    static const int minTrackedPts = 16;
+
+    LInfErrorTracker(ErrorComputerConstPtr errorComputer, const VectorC<Vector2d> &pts, const vector<double> &x, const vector<double> &y, int from)
+        : _errorComputer(errorComputer), _pts(pts), _x(x), _y(y), _from(from), _maxIdx(0) {}
+
+    //override
+    double computeErrorForCostBounded(CurvePrimitiveConstPtr curve, int to, double bound)
+    {
+        int numPts = _pts.numElems(_from, to) + 1;
+        if(curve->getType() != CurvePrimitive::ARC || numPts < minTrackedPts || _from < 0 || to >= (int)_pts.size())
+        {
+            _prevCurve = NULL;
+            return _errorComputer->computeErrorForCostBounded(curve, _from, to, bound);
+        }
+
+        if(!_prevCurve || numPts < (int)_bounds.size())
+            _bounds.assign(numPts, -1.); //negative means unknown
+        else
+        {
+            double delta = _perturbation(*_prevCurve, *curve);
+            for(int i = 0; i < (int)_bounds.size(); ++i)
+                _bounds[i] += delta;
+            _bounds.resize(numPts, -1.);
+        }
+        _prevCurve = NULL; //the bounds are invalid until the pass completes
+
+        //the first and last samples are measured to the ends of the curve
+        double error = 0;
+        _update(0, (curve->pos(0.) - _pts.flatAt(_from)).squaredNorm(), error);
+        _update(numPts - 1, (curve->pos(curve->length()) - _pts.flatAt(to)).squaredNorm(), error);
+        if(_maxIdx > 0 && _maxIdx < numPts - 1) //the previous maximum is likely to be large again
+            _update(_maxIdx, _distSq(*curve, _maxIdx), error);
+
+        for(int i = 1; i < numPts - 1 && error <= bound; ++i)
+        {
+            //the slack keeps rounding from skipping a sample that is at the maximum
+            if(_bounds[i] < 0. || _bounds[i] * (1. + 1e-9) >= sqrt(error))
+                _update(i, _distSq(*curve, i), error);
+        }
+
+        if(error <= bound)
+            _prevCurve = curve;
+        return error;
+    }
+
+private:
+    double _distSq(const CurvePrimitive &curve, int i) const
+    {
+        int idx = _pts.toLinearIdx(_from + i);
+        double out;
+        curve.distanceSqMany(1, &_x[idx], &_y[idx], &out); //not distanceSqTo, to match the full evaluation exactly
+        return out;
+    }
+
+    void _update(int i, double distSq, double &error)
+    {
+        _bounds[i] = sqrt(distSq);
+        if(distSq > error)
+        {
+            error = distSq;
+            _maxIdx = i;
+        }
+    }
+
+    //Bounds the distance from any point of "from" to "to".  Compares the points at the same arclength: at distance
+    //h along the curves from their midpoints, they are at most h apart per unit of angle difference and h^2 / 2 per
+    //unit of curvature difference.  If "to" is shorter, the rest of "from" is within its extra length.
+    static double _perturbation(const CurvePrimitive &from, const CurvePrimitive &to)
+    {
+        double half = 0.5 * from.length();
+        double out = (to.pos(half) - from.pos(half)).norm();
+        out += half * fabs(AngleUtils::toRange(to.angle(half) - from.angle(half), -PI));
+        out += 0.5 * SQR(half) * fabs(to.curvature(half) - from.curvature(half));
+        out += max(0., from.length() - to.length());
+        return out;
+    }
+
+    ErrorComputerConstPtr _errorComputer;
+    const VectorC<Vector2d> &_pts;
+    const vector<double> &_x, &_y;
+    int _from;
+    CurvePrimitiveConstPtr _prevCurve;
+    vector<double> _bounds; //indexed by the offset from _from
+    int _maxIdx;
+};
+
+ErrorTrackerPtr LInfErrorComputer::tracker(int from) const
+{
+    return new LInfErrorTracker(this, _pts, _x, _y, from);
+}
+
+//The L2 error, except that the cost of a line or an arc is computed in constant time from the moment table.  It uses
+//algebraic distances to the whole line or circle, so points that project past an end of the curve (but not the
+//first and last points, which are measured to the endpoints) count as closer than they are.
+class MomentL2ErrorComputer : public L2ErrorComputer
+{
+public:
+    MomentL2ErrorComputer(const Fitter &fitter, SpanMomentsConstPtr moments)
+        : L2ErrorComputer(fitter), _moments(moments) {}
+
+    double computeErrorForCost(CurvePrimitiveConstPtr curve, int from, int to,
+                               bool firstToEndpoint, bool lastToEndpoint, bool reversed) const
+    {
+        if(curve->getType() == CurvePrimitive::CLOTHOID || from == to || from < 0 || to >= (int)_pts.size())
+            return L2ErrorComputer::computeErrorForCost(curve, from, to, firstToEndpoint, lastToEndpoint, reversed);
+
+        double error = _moments->algebraicError(*curve, from, to);
+
+        //replace the terms of the end points that are measured to the ends of the curve
+        if(firstToEndpoint)
+        {
+            const Vector2d &pt = _pts.flatAt(from);
+            error -= (_weightsLeft.flatAt(from) + _weightsRight.flatAt(from)) * SQR(SpanMoments::algebraicDistance(*curve, pt));
+            error += _weightsRight.flatAt(from) * (curve->pos(reversed ? curve->length() : 0.) - pt).squaredNorm();
+        }
+        if(lastToEndpoint)
+        {
+            const Vector2d &pt = _pts.flatAt(to);
+            error -= (_weightsLeft.flatAt(to) + _weightsRight.flatAt(to)) * SQR(SpanMoments::algebraicDistance(*curve, pt));
+            error += _weightsLeft.flatAt(to) * (curve->pos(reversed ? 0. : curve->length()) - pt).squaredNorm();
+        }
+
+        return max(0., error) / curve->length();
+    }
+
+    double computeErrorForCostBounded(CurvePrimitiveConstPtr curve, int from, int to, double bound,
+                                      bool firstToEndpoint, bool lastToEndpoint, bool reversed) const
+    {
+        if(curve->getType() == CurvePrimitive::CLOTHOID)
+            return L2ErrorComputer::computeErrorForCostBounded(curve, from, to, bound, firstToEndpoint, lastToEndpoint, reversed);
+        return computeErrorForCost(curve, from, to, firstToEndpoint, lastToEndpoint, reversed); //already constant time
+    }
+
+private:
+    SpanMomentsConstPtr _moments;
 };
 
 class ErrorComputerCreator : public Algorithm<ERROR_COMPUTER>
 {
 public:
-    ErrorComputerCreator(bool lInf = true)
-        : _lInf(lInf) {}
+    enum Type
+    {
+        L_INFINITY,
+        L2,
+        L2_MOMENTS
+    };
 
-    string name() const { return _lInf ? "L-Infinity" : "L2"; }
+    ErrorComputerCreator(Type type = L_INFINITY)
+        : _type(type) {}
+
+    string name() const
+    {
+        const char *names[] = { "L-Infinity", "L2", "L2 Moments" };
+        return names[_type];
+    }
 
 protected:
     void _run(const Fitter &fitter, AlgorithmOutput<ERROR_COMPUTER> &out)
     {
-        out.errorComputer = _lInf ? new LInfErrorComputer(fitter) : new L2ErrorComputer(fitter);
+        switch(_type)
+        {
+        case L_INFINITY:
+            out.errorComputer = new LInfErrorComputer(fitter);
+            break;
+        case L2:
+            out.errorComputer = new L2ErrorComputer(fitter);
+            break;
+        case L2_MOMENTS:
+            out.moments = new SpanMoments(fitter.output<RESAMPLING>()->output);
+            out.errorComputer = new MomentL2ErrorComputer(fitter, out.moments);
+            break;
+        }
     }
 private:
-    bool _lInf;
+    Type _type;
 };
 
 void Algorithm<ERROR_COMPUTER>::_initialize()
 {
-    new ErrorComputerCreator(true);
-    new ErrorComputerCreator(false);
+    new ErrorComputerCreator(ErrorComputerCreator::L_INFINITY);
+    new ErrorComputerCreator(ErrorComputerCreator::L2);
+    new ErrorComputerCreator(ErrorComputerCreator::L2_MOMENTS);
 }
 
 
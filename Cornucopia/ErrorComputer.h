@@ -27,6 +27,8 @@
 NAMESPACE_Cornu
 
 CORNU_SMART_FORW_DECL(CurvePrimitive);
+CORNU_SMART_FORW_DECL(SpanMoments);
+CORNU_SMART_FORW_DECL(ErrorTracker);
 
 class ErrorComputer : public smart_base
 {
@@ -44,14 +46,35 @@ public:
     //Computes the error to be used in the graph weight--by default, the squared maximum distance to the curve
     virtual double computeErrorForCost(CurvePrimitiveConstPtr curve, int from, int to,
                                        bool firstToEndpoint = true, bool lastToEndpoint = true, bool reversed = false) const = 0;
+    //Same as computeErrorForCost if the result is at most bound.  Otherwise returns some value greater than bound,
+    //possibly without looking at all of the samples.
+    virtual double computeErrorForCostBounded(CurvePrimitiveConstPtr curve, int from, int to, double /*bound*/,
+                                              bool firstToEndpoint = true, bool lastToEndpoint = true, bool reversed = false) const
+    {
+        return computeErrorForCost(curve, from, to, firstToEndpoint, lastToEndpoint, reversed);
+    }
+    //Returns a tracker for the costs of curves fit to samples from "from" on, which is faster than calling
+    //computeErrorForCostBounded when the span grows one sample at a time
+    virtual ErrorTrackerPtr tracker(int from) const;
 };
 
 CORNU_SMART_TYPEDEFS(ErrorComputer);
 
+//Evaluates computeErrorForCostBounded (with both ends of the span measured to the ends of the curve) for a
+//sequence of curves that fit a span with a fixed start.  It may reuse work from the previous call, so it is meant
+//for spans that grow by one sample at a time, with curves that change a little between calls.
+class ErrorTracker : public smart_base
+{
+public:
+    virtual ~ErrorTracker() {}
+    virtual double computeErrorForCostBounded(CurvePrimitiveConstPtr curve, int to, double bound) = 0;
+};
+
 template<>
 struct AlgorithmOutput<ERROR_COMPUTER> : public AlgorithmOutputBase
 {
     ErrorComputerConstPtr errorComputer;
+    SpanMomentsConstPtr moments; //of the resampled points, for constant time errors of lines and arcs (L2 Moments only)
 };
 
 template<>
@@ -24,29 +24,89 @@
 #include "Resampler.h"
 #include "Combiner.h"
 #include "PrimitiveSequence.h"
+#include "PrimitiveFitter.h"
+#include "GraphConstructor.h"
+#include "Timer.h"
+#include "MemoryTracking.h"
 
 using namespace std;
 using namespace Eigen;
 NAMESPACE_Cornu
 
-void Fitter::run()
+Fitter::Fitter(const Fitter &other)
+    : _oversketchBase(other._oversketchBase), _originalSketch(other._originalSketch), _params(other._params),
+      _debugging(other._debugging), _numThreads(other._numThreads), _monitor(NULL), _stats(other._stats), _outputs(other._outputs),
+      _taskStage(NUM_ALGORITHM_STAGES), _stepping(false)
 {
+}
+
+Fitter &Fitter::operator=(const Fitter &other)
+{
+    _oversketchBase = other._oversketchBase;
+    _originalSketch = other._originalSketch;
+    _params = other._params;
+    _debugging = other._debugging;
+    _numThreads = other._numThreads;
+    _stats = other._stats;
+    _outputs = other._outputs;
+    _task = AlgorithmTaskPtr();
+    _taskStage = NUM_ALGORITHM_STAGES;
+    _stepping = false;
+    return *this;
+}
+
+void FitStats::clear()
+{
+    for(int i = 0; i < NUM_ALGORITHM_STAGES; ++i)
+    {
+        stageSeconds[i] = 0.;
+        stagePeakBytes[i] = 0;
+    }
+    resampledPoints = primitiveCandidates = graphVertices = graphEdges = 0;
+    pathFinderIterations = edgesValidated = edgesInvalidated = 0;
+    solverIterations = solverHalvings = solverRejections = 0;
+}
+
+//adds the time and the heap usage of (a piece of) a stage's work to the stats
+class StageMeasurement
+{
+public:
+    StageMeasurement(FitStats &stats, int stage) : _stats(stats), _stage(stage)
+    {
+        resetPeakAllocatedBytes();
+        _startBytes = allocatedBytes();
+    }
+
+    ~StageMeasurement()
+    {
+        _stats.stageSeconds[_stage] += _timer.elapsed();
+        _stats.stagePeakBytes[_stage] = max(_stats.stagePeakBytes[_stage], peakAllocatedBytes() - _startBytes);
+    }
+
+private:
+    StageMeasurement &operator=(const StageMeasurement &);
+
+    FitStats &_stats;
+    int _stage;
+    long long _startBytes;
+    Timer _timer;
+};
+
+bool Fitter::run(FitMonitor *monitor)
+{
+    Debugging::ThreadScope debuggingScope(_debugging);
+
     Debugging::get()->clear();
     Debugging::get()->printf("============= Starting =============");
     Debugging::get()->drawCurve(_originalSketch, Vector3d(0, 0, 0), "Original Sketch", 2., Debugging::DOTTED);
     Debugging::get()->startTiming("Total");
 
-    for(int i = 0; i < NUM_ALGORITHM_STAGES; ++i)
+    if(!_runStages(COMBINING, monitor))
     {
-        if(!(_outputs[i]))
-        {
-            std::string stageName = AlgorithmBase::get((AlgorithmStage)i, 0)->stageName();
-            Debugging::get()->startTiming(stageName);
-            _runStage((AlgorithmStage)i);
-            if(Debugging::get()->getTimeElapsed(stageName) > 0.001) //only print significant times
-                Debugging::get()->elapsedTime(stageName);
-        }
+        Debugging::get()->printf("Cancelled");
+        return false;
     }
+
     Debugging::get()->elapsedTime("Total");
 
     if(Debugging::get()->isDebuggingOn() && finalOutput())
@@ -60,17 +120,161 @@ void Fitter::run()
             Debugging::get()->drawCurvatureField(out->primitives()[i], Vector3d(1, 0, 0), "Normal Field");
         }
     }
+
+    return true;
+}
+
+bool Fitter::runUpTo(AlgorithmStage lastStage, FitMonitor *monitor)
+{
+    Debugging::ThreadScope debuggingScope(_debugging);
+    return _runStages(lastStage, monitor);
+}
+
+bool Fitter::_runStages(AlgorithmStage lastStage, FitMonitor *monitor)
+{
+    _monitor = monitor;
+    _stats.clear();
+    _stepping = false;
+    bool done = true;
+
+    for(int i = 0; i <= lastStage; ++i)
+    {
+        if(!(_outputs[i]))
+        {
+            if(cancelled())
+            {
+                done = false;
+                break;
+            }
+
+            std::string stageName = AlgorithmBase::get((AlgorithmStage)i, 0)->stageName();
+            Debugging::get()->startTiming(stageName);
+            reportProgress((AlgorithmStage)i, 0.);
+            {
+                StageMeasurement measurement(_stats, i);
+                _runStage((AlgorithmStage)i);
+            }
+            if(cancelled()) //the output may be incomplete
+            {
+                _outputs[i] = AlgorithmOutputBasePtr();
+                done = false;
+                break;
+            }
+            reportProgress((AlgorithmStage)i, 1.);
+            if(Debugging::get()->getTimeElapsed(stageName) > 0.001) //only print significant times
+                Debugging::get()->elapsedTime(stageName);
+        }
+    }
+
+    _monitor = NULL;
+    _countOutputs();
+    return done;
+}
+
+void Fitter::setParams(const Parameters &params)
+{
+    AlgorithmStage firstAffected = firstAffectedStage(_params, params);
+    _params = params;
+    _clearBefore(firstAffected);
+}
+
+AlgorithmStage Fitter::firstAffectedStage(const Parameters &before, const Parameters &after)
+{
+    //scale() reads the pixel size and nearly every stage uses the scale
+    if(before.get(Parameters::PIXEL_SIZE) != after.get(Parameters::PIXEL_SIZE))
+        return SCALE_DETECTION;
+
+    for(int i = 0; i < NUM_ALGORITHM_STAGES; ++i)
+    {
+        if(before.getAlgorithm(i) != after.getAlgorithm(i))
+            return (AlgorithmStage)i;
+
+        vector<ParameterDependency> dependencies = AlgorithmBase::get((AlgorithmStage)i, after.getAlgorithm(i))->dependencies();
+        for(int j = 0; j < (int)dependencies.size(); ++j)
+        {
+            if(dependencies[j].changed(before, after))
+                return (AlgorithmStage)i;
+        }
+    }
+
+    return NUM_ALGORITHM_STAGES; //nothing needs to be rerun
+}
+
+bool Fitter::step(double budget)
+{
+    Debugging::ThreadScope debuggingScope(_debugging);
+    Timer timer;
+
+    if(!_stepping) //starting a new fit
+    {
+        _stats.clear();
+        _stepping = true;
+    }
+
+    for(int i = 0; i < NUM_ALGORITHM_STAGES; ++i)
+    {
+        if(_outputs[i])
+            continue;
+
+        StageMeasurement measurement(_stats, i);
+
+        if(!_task)
+        {
+            _task = AlgorithmBase::get((AlgorithmStage)i, _params.getAlgorithm(i))->startTask(*this);
+            _taskStage = (AlgorithmStage)i;
+        }
+
+        while(!_task->step())
+        {
+            if(timer.elapsed() >= budget)
+                return false;
+        }
+
+        _outputs[i] = _task->output();
+        _task = AlgorithmTaskPtr();
+
+        if(i + 1 < NUM_ALGORITHM_STAGES && timer.elapsed() >= budget)
+            return false;
+    }
+
+    _stepping = false;
+    _countOutputs();
+    return true;
 }
 
 void Fitter::_runStage(AlgorithmStage stage)
 {
+    if(_task) //finish what step() started
+    {
+        while(!_task->step() && !cancelled())
+            ;
+        _outputs[stage] = _task->output();
+        _task = AlgorithmTaskPtr();
+        return;
+    }
+
     _outputs[stage] = AlgorithmBase::get(stage, _params.getAlgorithm(stage))->run(*this);
 }
 
+void Fitter::_countOutputs()
+{
+    if(_outputs[RESAMPLING])
+        _stats.resampledPoints = output<RESAMPLING>()->output->pts().size();
+    if(_outputs[PRIMITIVE_FITTING])
+        _stats.primitiveCandidates = (int)output<PRIMITIVE_FITTING>()->primitives.size();
+    if(_outputs[GRAPH_CONSTRUCTION])
+    {
+        _stats.graphVertices = (int)output<GRAPH_CONSTRUCTION>()->vertices.size();
+        _stats.graphEdges = (int)output<GRAPH_CONSTRUCTION>()->edges.size();
+    }
+}
+
 void Fitter::_clearBefore(AlgorithmStage stage)
 {
     for(int i = stage; i < NUM_ALGORITHM_STAGES; ++i)
         _outputs[i] = AlgorithmOutputBasePtr();
+    if(_taskStage >= stage)
+        _task = AlgorithmTaskPtr();
 }
 
 double Fitter::scale() const
@@ -85,6 +289,8 @@ double Fitter::scaledParameter(Parameters::ParameterType param) const
 
 PrimitiveSequenceConstPtr Fitter::finalOutput() const
 {
+    if(!_outputs[COMBINING])
+        return PrimitiveSequenceConstPtr();
     return output<COMBINING>()->output;
 }
 
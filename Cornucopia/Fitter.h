@@ -30,13 +30,61 @@ NAMESPACE_Cornu
 CORNU_SMART_FORW_DECL(Polyline);
 CORNU_SMART_FORW_DECL(PrimitiveSequence);
 
+//Passed to Fitter::run() to follow the progress of a fit and to abort it.  cancel() may be called from any thread;
+//the fitting thread polls cancelled() between stages and inside the long loops of the stages and calls progress().
+class FitMonitor
+{
+public:
+    FitMonitor() : _cancelled(0) {}
+    virtual ~FitMonitor() {}
+
+    void cancel() { memoryBarrier(); _cancelled = 1; }
+    virtual bool cancelled() const { return _cancelled != 0; }
+
+    //fraction goes from 0 to 1 within each stage that runs; not every stage reports intermediate values.  With
+    //Fitter::setNumThreads(), this may be called from the stage's worker threads, but never concurrently.
+    virtual void progress(AlgorithmStage /*stage*/, double /*fraction*/) {}
+
+private:
+    volatile int _cancelled;
+};
+
+//Measurements of a fit, for performance monitoring.  The counts of work done (iterations, validations, solver
+//iterations) and the per-stage figures cover only the stages that ran, not those whose output was reused.
+struct FitStats
+{
+    FitStats() { clear(); }
+    void clear();
+
+    double stageSeconds[NUM_ALGORITHM_STAGES]; //wall-clock time
+    //peak heap usage while the stage ran, over what was allocated when it started; only measured if the library
+    //is built with CORNU_TRACK_ALLOCATIONS (see MemoryTracking.h)
+    long long stagePeakBytes[NUM_ALGORITHM_STAGES];
+
+    int resampledPoints;
+    int primitiveCandidates;
+    int graphVertices;
+    int graphEdges;
+
+    int pathFinderIterations; //shortest path computations
+    int edgesValidated; //edges whose estimated cost was checked by combining the two curves
+    int edgesInvalidated; //validated edges whose cost turned out higher than estimated
+
+    int solverIterations; //over all the LSSolver runs
+    int solverHalvings; //line search step halvings over all the LSSolver runs
+    int solverRejections; //rejected steps over all the LSSolver runs in the trust region mode
+};
+
 class Fitter
 {
 public:
-    Fitter() : _outputs(NUM_ALGORITHM_STAGES) {}
+    Fitter() : _debugging(NULL), _numThreads(1), _monitor(NULL), _outputs(NUM_ALGORITHM_STAGES), _taskStage(NUM_ALGORITHM_STAGES), _stepping(false) {}
+    //copies share the stage outputs, but not a stage step() is in the middle of--the copy starts that stage over
+    Fitter(const Fitter &other);
+    Fitter &operator=(const Fitter &other);
 
     const Parameters &params() const { return _params; }
-    void setParams(const Parameters &params) { _params = params; _clearBefore(SCALE_DETECTION); }
+    void setParams(const Parameters &params); //only the stages affected by the change will be rerun
 
     PolylineConstPtr originalSketch() const { return _originalSketch; }
     void setOriginalSketch(PolylineConstPtr originalSketch) { _originalSketch = originalSketch; _clearBefore(SCALE_DETECTION); }
@@ -44,13 +92,48 @@ public:
     PrimitiveSequenceConstPtr oversketchBase() const { return _oversketchBase; }
     void setOversketchBase(PrimitiveSequenceConstPtr oversketchBase) { _oversketchBase = oversketchBase; _clearBefore(SCALE_DETECTION); }
 
+    //Debugging output of run() goes here instead of the global Debugging object (NULL means use the global one).
+    //Fitters running concurrently on different threads should each have their own (or Debugging::silent()).
+    Debugging *debugging() const { return _debugging; }
+    void setDebugging(Debugging *debugging) { _debugging = debugging; }
+
+    //The number of threads a stage may split its work across (0 means one per processor).  The output is the same
+    //for any number of threads.  The default is 1, which is best when many fitters run in parallel already.
+    int numThreads() const { return _numThreads; }
+    void setNumThreads(int numThreads) { _numThreads = numThreads; }
+
     template<int AlgStage>
     smart_ptr<const AlgorithmOutput<AlgStage> > output() const
     {
         return static_pointer_cast<const AlgorithmOutput<AlgStage> >(_outputs[AlgStage]);
     }
 
-    void run();
+    //Both return false if the monitor cancelled the fit.  The stages that completed keep their outputs, so running
+    //again continues from the stage that was interrupted.
+    bool run(FitMonitor *monitor = NULL);
+    bool runUpTo(AlgorithmStage lastStage, FitMonitor *monitor = NULL); //runs the stages up to and including lastStage, with no final debugging output
+
+    //Advances the fit by about budget seconds of work and returns true once it is finished, for hosts that can't
+    //block or use a separate thread.  Work is done in steps (a stage or, for the slow stages, one iteration of
+    //their main loop), and the budget is checked between them, so it may be exceeded by one step.  Changing the
+    //sketch or the parameters between calls restarts the affected stages; run() finishes a fit begun by step().
+    bool step(double budget);
+
+    //for the algorithms: whether the running fit should stop as soon as possible (the output of the current stage
+    //is then discarded, so it may be incomplete) and reporting the fraction of the current stage that's done
+    bool cancelled() const { return _monitor && _monitor->cancelled(); }
+    void reportProgress(AlgorithmStage stage, double fraction) const { if(_monitor) _monitor->progress(stage, fraction); }
+
+    const FitStats &stats() const { return _stats; } //of the last run() or of the fit step() is doing
+    FitStats &runningStats() const { return _stats; } //for the algorithms to count their work
+
+    //Returns a copy of this fitter with different parameters.  Stage outputs are immutable, so the copy shares
+    //those that the new parameters don't affect and only the later stages are rerun.  Forks may run on different
+    //threads at the same time.
+    Fitter fork(const Parameters &params) const { Fitter out(*this); out.setParams(params); return out; }
+
+    //the first stage whose output may differ between fits with the two parameter sets (NUM_ALGORITHM_STAGES if none)
+    static AlgorithmStage firstAffectedStage(const Parameters &before, const Parameters &after);
 
     PrimitiveSequenceConstPtr finalOutput() const; //returns null if fitting failed for some reason
     const std::vector<double> &originalSketchToFinalParameters() const; //returns a vector that for each original sketch point has the final parameter value
@@ -59,14 +142,23 @@ public:
     double scaledParameter(Parameters::ParameterType param) const;
 
 private:
+    bool _runStages(AlgorithmStage lastStage, FitMonitor *monitor);
     void _runStage(AlgorithmStage stage);
+    void _countOutputs();
     void _clearBefore(AlgorithmStage stage);
 
     PrimitiveSequenceConstPtr _oversketchBase;
     PolylineConstPtr _originalSketch;
     Parameters _params;
+    Debugging *_debugging;
+    int _numThreads;
+    FitMonitor *_monitor; //only set while running
+    mutable FitStats _stats;
 
     std::vector<AlgorithmOutputBasePtr> _outputs;
+    AlgorithmTaskPtr _task; //the stage step() is in the middle of
+    AlgorithmStage _taskStage;
+    bool _stepping; //whether step() is in the middle of a fit
 };
 
 END_NAMESPACE_Cornu
@@ -25,6 +25,7 @@ Copyright 1984, 1987, 1989, 2000 by Stephen L. Moshier
 */
 
 #include "Fresnel.h"
+#include "FresnelKernels.h"
 #include <vector>
 #include <iostream>
 
@@ -67,6 +68,131 @@ static Scalar p1evl( const Scalar &x, const Matrix<Scalar, Dynamic, 1> &coefVec
 
 //==================Coefficients===========================
 
+const FresnelCoefficients fresnelCoefficients =
+{
+    { //sn
+        -2.99181919401019853726E3,
+        7.08840045257738576863E5,
+        -6.29741486205862506537E7,
+        2.54890880573376359104E9,
+        -4.42979518059697779103E10,
+        3.18016297876567817986E11
+    },
+    { //sd, the leading 1 is omitted
+        2.81376268889994315696E2,
+        4.55847810806532581675E4,
+        5.17343888770096400730E6,
+        4.19320245898111231129E8,
+        2.24411795645340920940E10,
+        6.07366389490084639049E11
+    },
+    { //cn
+        -4.98843114573573548651E-8,
+        9.50428062829859605134E-6,
+        -6.45191435683965050962E-4,
+        1.88843319396703850064E-2,
+        -2.05525900955013891793E-1,
+        9.99999999999999998822E-1
+    },
+    { //cd
+        3.99982968972495980367E-12,
+        9.15439215774657478799E-10,
+        1.25001862479598821474E-7,
+        1.22262789024179030997E-5,
+        8.68029542941784300606E-4,
+        4.12142090722199792936E-2,
+        1.00000000000000000118E0
+    },
+    { //fn
+        4.21543555043677546506E-1,
+        1.43407919780758885261E-1,
+        1.15220955073585758835E-2,
+        3.45017939782574027900E-4,
+        4.63613749287867322088E-6,
+        3.05568983790257605827E-8,
+        1.02304514164907233465E-10,
+        1.72010743268161828879E-13,
+        1.34283276233062758925E-16,
+        3.76329711269987889006E-20
+    },
+    { //fd, the leading 1 is omitted
+        7.51586398353378947175E-1,
+        1.16888925859191382142E-1,
+        6.44051526508858611005E-3,
+        1.55934409164153020873E-4,
+        1.84627567348930545870E-6,
+        1.12699224763999035261E-8,
+        3.60140029589371370404E-11,
+        5.88754533621578410010E-14,
+        4.52001434074129701496E-17,
+        1.25443237090011264384E-20
+    },
+    { //gn
+        5.04442073643383265887E-1,
+        1.97102833525523411709E-1,
+        1.87648584092575249293E-2,
+        6.84079380915393090172E-4,
+        1.15138826111884280931E-5,
+        9.82852443688422223854E-8,
+        4.45344415861750144738E-10,
+        1.08268041139020870318E-12,
+        1.37555460633261799868E-15,
+        8.36354435630677421531E-19,
+        1.86958710162783235106E-22
+    },
+    { //gd, the leading 1 is omitted
+        1.47495759925128324529E0,
+        3.37748989120019970451E-1,
+        2.53603741420338795122E-2,
+        8.14679107184306179049E-4,
+        1.27545075667729118702E-5,
+        1.04314589657571990585E-7,
+        4.60680728146520428211E-10,
+        1.10273215066240270757E-12,
+        1.38796531259578871258E-15,
+        8.39158816283118707363E-19,
+        1.86958710162783236342E-22
+    },
+    { //approxSn
+        1.647629463788700E-009,
+        -1.522754752581096E-007,
+        8.424748808502400E-006,
+        -3.120693124703272E-004,
+        7.244727626597022E-003,
+        -9.228055941124598E-002,
+        5.235987735681432E-001
+    },
+    { //approxCn
+        1.416802502367354E-008,
+        -1.157231412229871E-006,
+        5.387223446683264E-005,
+        -1.604381798862293E-003,
+        2.818489036795073E-002,
+        -2.467398198317899E-001,
+        9.999999760004487E-001
+    },
+    { //approxFn
+        -1.903009855649792E+012,
+        1.355942388050252E+011,
+        -4.158143148511033E+009,
+        7.343848463587323E+007,
+        -8.732356681548485E+005,
+        8.560515466275470E+003,
+        -1.032877601091159E+002,
+        2.999401847870011E+000
+    },
+    { //approxGn
+        -1.860843997624650E+011,
+        1.278350673393208E+010,
+        -3.779387713202229E+008,
+        6.492611570598858E+006,
+        -7.787789623358162E+004,
+        8.602931494734327E+002,
+        -1.493439396592284E+001,
+        9.999841934744914E-001
+    }
+};
+
 //double precision rational coefficients for s, c, f, and g
 static VectorXd dsn(6), dsd(6);
 static VectorXd dcn(6), dcd(7);
@@ -87,133 +213,25 @@ struct InitCoefs
 {
     InitCoefs()
     {
-        initPolynomial();
-        initRational();
+        const FresnelCoefficients &coef = fresnelCoefficients;
+        dsn = Map<const VectorXd>(coef.sn, 6);
+        dsd = Map<const VectorXd>(coef.sd, 6);
+        dcn = Map<const VectorXd>(coef.cn, 6);
+        dcd = Map<const VectorXd>(coef.cd, 7);
+        dfn = Map<const VectorXd>(coef.fn, 10);
+        dfd = Map<const VectorXd>(coef.fd, 10);
+        dgn = Map<const VectorXd>(coef.gn, 11);
+        dgd = Map<const VectorXd>(coef.gd, 11);
+        dssn = Map<const VectorXd>(coef.approxSn, 7);
+        dscn = Map<const VectorXd>(coef.approxCn, 7);
+        dsfn = Map<const VectorXd>(coef.approxFn, 8);
+        dsgn = Map<const VectorXd>(coef.approxGn, 8);
+
         ssn = dssn.cast<float>();
         scn = dscn.cast<float>();
         sfn = dsfn.cast<float>();
         sgn = dsgn.cast<float>();
     }
-
-    void initPolynomial()
-    {
-        dssn <<
-            1.647629463788700E-009,
-            -1.522754752581096E-007,
-            8.424748808502400E-006,
-            -3.120693124703272E-004,
-            7.244727626597022E-003,
-            -9.228055941124598E-002,
-            5.235987735681432E-001;
-        dscn <<
-            1.416802502367354E-008,
-            -1.157231412229871E-006,
-            5.387223446683264E-005,
-            -1.604381798862293E-003,
-            2.818489036795073E-002,
-            -2.467398198317899E-001,
-            9.999999760004487E-001;
-        dsfn <<
-            -1.903009855649792E+012,
-            1.355942388050252E+011,
-            -4.158143148511033E+009,
-            7.343848463587323E+007,
-            -8.732356681548485E+005,
-            8.560515466275470E+003,
-            -1.032877601091159E+002,
-            2.999401847870011E+000;
-        dsgn <<
-            -1.860843997624650E+011,
-            1.278350673393208E+010,
-            -3.779387713202229E+008,
-            6.492611570598858E+006,
-            -7.787789623358162E+004,
-            8.602931494734327E+002,
-            -1.493439396592284E+001,
-            9.999841934744914E-001;
-    }
-
-    void initRational()
-    {
-        dsn <<
-            -2.99181919401019853726E3,
-            7.08840045257738576863E5,
-            -6.29741486205862506537E7,
-            2.54890880573376359104E9,
-            -4.42979518059697779103E10,
-            3.18016297876567817986E11;
-        dsd <<
-            /* 1.00000000000000000000E0,*/
-            2.81376268889994315696E2,
-            4.55847810806532581675E4,
-            5.17343888770096400730E6,
-            4.19320245898111231129E8,
-            2.24411795645340920940E10,
-            6.07366389490084639049E11;
-        dcn <<
-            -4.98843114573573548651E-8,
-            9.50428062829859605134E-6,
-            -6.45191435683965050962E-4,
-            1.88843319396703850064E-2,
-            -2.05525900955013891793E-1,
-            9.99999999999999998822E-1;
-        dcd <<
-            3.99982968972495980367E-12,
-            9.15439215774657478799E-10,
-            1.25001862479598821474E-7,
-            1.22262789024179030997E-5,
-            8.68029542941784300606E-4,
-            4.12142090722199792936E-2,
-            1.00000000000000000118E0;
-        dfn <<
-            4.21543555043677546506E-1,
-            1.43407919780758885261E-1,
-            1.15220955073585758835E-2,
-            3.45017939782574027900E-4,
-            4.63613749287867322088E-6,
-            3.05568983790257605827E-8,
-            1.02304514164907233465E-10,
-            1.72010743268161828879E-13,
-            1.34283276233062758925E-16,
-            3.76329711269987889006E-20;
-        dfd <<
-            /*  1.00000000000000000000E0,*/
-            7.51586398353378947175E-1,
-            1.16888925859191382142E-1,
-            6.44051526508858611005E-3,
-            1.55934409164153020873E-4,
-            1.84627567348930545870E-6,
-            1.12699224763999035261E-8,
-            3.60140029589371370404E-11,
-            5.88754533621578410010E-14,
-            4.52001434074129701496E-17,
-            1.25443237090011264384E-20;
-        dgn <<
-            5.04442073643383265887E-1,
-            1.97102833525523411709E-1,
-            1.87648584092575249293E-2,
-            6.84079380915393090172E-4,
-            1.15138826111884280931E-5,
-            9.82852443688422223854E-8,
-            4.45344415861750144738E-10,
-            1.08268041139020870318E-12,
-            1.37555460633261799868E-15,
-            8.36354435630677421531E-19,
-            1.86958710162783235106E-22;
-        dgd <<
-            /*  1.00000000000000000000E0,*/
-            1.47495759925128324529E0,
-            3.37748989120019970451E-1,
-            2.53603741420338795122E-2,
-            8.14679107184306179049E-4,
-            1.27545075667729118702E-5,
-            1.04314589657571990585E-7,
-            4.60680728146520428211E-10,
-            1.10273215066240270757E-12,
-            1.38796531259578871258E-15,
-            8.39158816283118707363E-19,
-            1.86958710162783236342E-22;
-    }
 } init;
 
 //full double precision accuracy using rational functions
@@ -318,13 +336,142 @@ done:
     *ssa = ss;
 }
 
-//The double precision version is not vectorized because the scalar version is actually faster
-void fresnel(const VectorXd &t, VectorXd *s, VectorXd *c)
+//==================Table===========================
+
+//The table covers [0, tableEnd) with segments of width 1 / tableSegmentsPerUnit.  Each segment has a polynomial for
+//S and one for C in a variable that goes from -1 to 1 over the segment, interpolating the rational approximation at
+//the Chebyshev nodes.  The error of the interpolation grows with x (the integrands oscillate faster) and is largest
+//just before tableEnd.  Past it, truncated asymptotic series for the auxiliary functions f and g take over.
+static const int tableDegree = 7;
+static const int tableSegmentsPerUnit = 32;
+static const int tableEnd = 8;
+static const int tableSegments = tableEnd * tableSegmentsPerUnit;
+
+struct FresnelTableSegment
+{
+    double s[tableDegree + 1]; //highest degree first
+    double c[tableDegree + 1];
+};
+
+static FresnelTableSegment fresnelTableSegments[tableSegments]; //32KB
+
+struct InitTable
+{
+    InitTable()
+    {
+        const int numNodes = tableDegree + 1;
+        const double halfWidth = 0.5 / tableSegmentsPerUnit;
+
+        //the monomial coefficients of the Chebyshev polynomials, cheb[j][k] is the coefficient of u^k in T_j(u)
+        double cheb[numNodes][numNodes] = { { 0 } };
+        cheb[0][0] = 1.;
+        cheb[1][1] = 1.;
+        for(int j = 2; j < numNodes; ++j)
+        {
+            for(int k = 0; k < numNodes; ++k)
+                cheb[j][k] = (k > 0 ? 2. * cheb[j - 1][k - 1] : 0.) - cheb[j - 2][k];
+        }
+
+        for(int seg = 0; seg < tableSegments; ++seg)
+        {
+            double center = (seg + 0.5) / tableSegmentsPerUnit;
+
+            double nodeU[numNodes], nodeS[numNodes], nodeC[numNodes];
+            for(int k = 0; k < numNodes; ++k)
+            {
+                nodeU[k] = cos(PI * (k + 0.5) / numNodes);
+                fresnel(center + halfWidth * nodeU[k], nodeS + k, nodeC + k);
+            }
+
+            FresnelTableSegment &out = fresnelTableSegments[seg];
+            for(int k = 0; k < numNodes; ++k)
+                out.s[k] = out.c[k] = 0.;
+            for(int j = 0; j < numNodes; ++j)
+            {
+                //the Chebyshev coefficient of T_j
+                double chebS = 0., chebC = 0.;
+                for(int k = 0; k < numNodes; ++k)
+                {
+                    double tj = cos(j * PI * (k + 0.5) / numNodes);
+                    chebS += nodeS[k] * tj;
+                    chebC += nodeC[k] * tj;
+                }
+                double scale = (j == 0 ? 1. : 2.) / numNodes;
+                for(int k = 0; k < numNodes; ++k)
+                {
+                    out.s[tableDegree - k] += scale * chebS * cheb[j][k];
+                    out.c[tableDegree - k] += scale * chebC * cheb[j][k];
+                }
+            }
+        }
+    }
+} initTable; //after init, because it uses fresnel
+
+void fresnelTable(double xxa, double *ssa, double *cca)
+{
+    double cc, ss;
+    double x = fabs(xxa);
+
+    if(x < tableEnd)
+    {
+        double scaled = x * tableSegmentsPerUnit;
+        int seg = (int)scaled;
+        double u = 2. * (scaled - seg) - 1.;
+
+        const FresnelTableSegment &segment = fresnelTableSegments[seg];
+        ss = segment.s[0];
+        cc = segment.c[0];
+        for(int i = 1; i <= tableDegree; ++i)
+        {
+            ss = ss * u + segment.s[i];
+            cc = cc * u + segment.c[i];
+        }
+    }
+    else if(x > 36974.0)
+    {
+        cc = 0.5;
+        ss = 0.5;
+    }
+    else
+    {
+        double x2 = x * x;
+        double t = 1. / (PI * x2);
+        double u = t * t;
+        double f = 1. - u * (3. - u * (105. - u * 10395.));
+        double g = t * (1. - u * (15. - u * (945. - u * 135135.)));
+
+        //pi/2 x^2 reduced exactly (up to the rounding of x^2) to between -pi and pi
+        double angle = HALFPI * (x2 - 4. * floor(0.25 * x2 + 0.5));
+        double c = cos(angle), s = sin(angle);
+        t = PI * x;
+        cc = 0.5  +  (f * s  -  g * c)/t;
+        ss = 0.5  -  (f * c  +  g * s)/t;
+    }
+
+    if(xxa < 0.0)
+    {
+        cc = -cc;
+        ss = -ss;
+    }
+
+    *cca = cc;
+    *ssa = ss;
+}
+
+void fresnelTable(const VectorXd &t, VectorXd *s, VectorXd *c)
 {
     s->resize(t.size());
     c->resize(t.size());
     for(int i = 0; i < t.size(); ++i)
-        fresnel(t[i], &((*s)[i]), &((*c)[i]));
+        fresnelTable(t[i], &((*s)[i]), &((*c)[i]));
+}
+
+//Without AVX2, the double precision version is not vectorized because the scalar version is actually faster
+//than Eigen's SSE packets
+static void fresnelManySSE2(int n, const double *t, double *s, double *c)
+{
+    for(int i = 0; i < n; ++i)
+        fresnel(t[i], s + i, c + i);
 }
 
 //Vectorization stuff
@@ -431,7 +578,7 @@ void fresnelMed( const Packet4f &xxa, Packet4f *ssa, Packet4f *cca )
 }
 
 //This version is vectorized
-void fresnelApprox(const VectorXd &t, VectorXd *s, VectorXd *c)
+static void fresnelApproxManySSE2(int n, const double *t, double *s, double *c)
 {
     const int packetSize = 4;
     typedef Packet4f Packet;
@@ -440,24 +587,21 @@ void fresnelApprox(const VectorXd &t, VectorXd *s, VectorXd *c)
     typedef Matrix<float, packetSize, 1> ValVec;
     typedef Matrix<int, packetSize, 1> IdxVec;
 
-    s->resize(t.size());
-    c->resize(t.size());
-
     ValVec lowVal, medVal;
     IdxVec lowIdx, medIdx;
     Packet pval, ps, pc;
     ValVec vs, vc;
     int lowNum = 0, medNum = 0;
 
-    for(int i = 0; i < t.size(); ++i)
+    for(int i = 0; i < n; ++i)
     {
         double vsq = t[i] * t[i];
         if(vsq > 1367076676)
         {
             if(t[i] < 0)
-                (*s)[i] = (*c)[i] = -0.5;
+                s[i] = c[i] = -0.5;
             else
-                (*s)[i] = (*c)[i] = 0.5;
+                s[i] = c[i] = 0.5;
 
             continue;
         }
@@ -474,8 +618,8 @@ void fresnelApprox(const VectorXd &t, VectorXd *s, VectorXd *c)
                 vc.writePacket<Aligned>(0, pc);
                 for(int j = 0; j < packetSize; ++j)
                 {
-                    (*s)[lowIdx[j]] = vs[j];
-                    (*c)[lowIdx[j]] = vc[j];
+                    s[lowIdx[j]] = vs[j];
+                    c[lowIdx[j]] = vc[j];
                 }
                 lowNum = 0;
             }
@@ -493,8 +637,8 @@ void fresnelApprox(const VectorXd &t, VectorXd *s, VectorXd *c)
                 vc.writePacket<Aligned>(0, pc);
                 for(int j = 0; j < packetSize; ++j)
                 {
-                    (*s)[medIdx[j]] = vs[j];
-                    (*c)[medIdx[j]] = vc[j];
+                    s[medIdx[j]] = vs[j];
+                    c[medIdx[j]] = vc[j];
                 }
                 medNum = 0;
             }
@@ -503,23 +647,91 @@ void fresnelApprox(const VectorXd &t, VectorXd *s, VectorXd *c)
 
     //finish up
     for(int i = 0; i < lowNum; ++i)
-        fresnelApprox(lowVal[i], &((*s)[lowIdx[i]]), &((*c)[lowIdx[i]]));
+        fresnelApprox(lowVal[i], s + lowIdx[i], c + lowIdx[i]);
     for(int i = 0; i < medNum; ++i)
-        fresnelApprox(medVal[i], &((*s)[medIdx[i]]), &((*c)[medIdx[i]]));
+        fresnelApprox(medVal[i], s + medIdx[i], c + medIdx[i]);
 }
 
 #else //EIGEN_VECTORIZE_SSE
 
 //The unvectorized version
-void fresnelApprox(const VectorXd &t, VectorXd *s, VectorXd *c)
+static void fresnelApproxManySSE2(int n, const double *t, double *s, double *c)
+{
+    for(int i = 0; i < n; ++i)
+        fresnelApprox(t[i], s + i, c + i);
+}
+
+#endif //EIGEN_VECTORIZE_SSE
+
+//==================Kernel selection===========================
+
+static FresnelKernels findFastestFresnelKernels()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if(avx512FresnelCompiled() && __builtin_cpu_supports("avx512f"))
+        return FRESNEL_AVX512;
+    if(avx2FresnelCompiled() && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return FRESNEL_AVX2;
+#endif
+    return FRESNEL_SSE2;
+}
+
+FresnelKernels fastestFresnelKernels()
+{
+    static const FresnelKernels fastest = findFastestFresnelKernels();
+    return fastest;
+}
+
+const char *fresnelKernelsName(FresnelKernels kernels)
+{
+    static const char *names[NUM_FRESNEL_KERNELS] = { "SSE2", "AVX2", "AVX-512" };
+    return names[kernels];
+}
+
+void fresnelMany(FresnelKernels kernels, int n, const double *t, double *outS, double *outC)
+{
+    switch(kernels)
+    {
+    case FRESNEL_AVX512:
+        fresnelManyAVX512(n, t, outS, outC);
+        break;
+    case FRESNEL_AVX2:
+        fresnelManyAVX2(n, t, outS, outC);
+        break;
+    default:
+        fresnelManySSE2(n, t, outS, outC);
+    }
+}
+
+void fresnelApproxMany(FresnelKernels kernels, int n, const double *t, double *outS, double *outC)
+{
+    switch(kernels)
+    {
+    case FRESNEL_AVX512:
+        fresnelApproxManyAVX512(n, t, outS, outC);
+        break;
+    case FRESNEL_AVX2:
+        fresnelApproxManyAVX2(n, t, outS, outC);
+        break;
+    default:
+        fresnelApproxManySSE2(n, t, outS, outC);
+    }
+}
+
+void fresnel(const VectorXd &t, VectorXd *s, VectorXd *c)
 {
     s->resize(t.size());
     c->resize(t.size());
-    for(int i = 0; i < t.size(); ++i)
-        fresnelApprox(t[i], &((*s)[i]), &((*c)[i]));
+    fresnelMany(fastestFresnelKernels(), (int)t.size(), t.data(), s->data(), c->data());
 }
 
-#endif //EIGEN_VECTORIZE_SSE
+void fresnelApprox(const VectorXd &t, VectorXd *s, VectorXd *c)
+{
+    s->resize(t.size());
+    c->resize(t.size());
+    fresnelApproxMany(fastestFresnelKernels(), (int)t.size(), t.data(), s->data(), c->data());
+}
 
 END_NAMESPACE_Cornu
 
@@ -0,0 +1,78 @@
+/*--
+    FresnelKernels.h  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_FRESNELKERNELS_H_INCLUDED
+#define CORNUCOPIA_FRESNELKERNELS_H_INCLUDED
+
+//Batch Fresnel integrals behind fresnel(const VectorXd &, ...) and fresnelApprox(const VectorXd &, ...).  There are
+//AVX2 and AVX-512 versions, in files compiled for those instruction sets, which are used when the processor supports
+//them.  Those files include this one, so like ProjectionKernels.h, it must not include anything with inline functions.
+
+namespace Cornu
+{
+
+enum FresnelKernels
+{
+    FRESNEL_SSE2, //scalar for the double precision version, Eigen's SSE packets for the approximate one
+    FRESNEL_AVX2,
+    FRESNEL_AVX512,
+
+    NUM_FRESNEL_KERNELS
+};
+
+FresnelKernels fastestFresnelKernels(); //the best kernels that the processor supports and that were compiled in
+const char *fresnelKernelsName(FresnelKernels kernels);
+
+//These write the n values of the Fresnel integrals of t to outS and outC, using the given kernels, which must be
+//no better than fastestFresnelKernels()
+void fresnelMany(FresnelKernels kernels, int n, const double *t, double *outS, double *outC);
+void fresnelApproxMany(FresnelKernels kernels, int n, const double *t, double *outS, double *outC);
+
+//The coefficients of the approximations, highest degree first, from the Cephes library.  They are defined in
+//Fresnel.cpp and shared with the kernels.
+struct FresnelCoefficients
+{
+    //rational, for x^2 < 2.5625 and for the auxiliary functions f and g above that
+    double sn[6], sd[6]; //the leading 1 of the denominator is omitted
+    double cn[6], cd[7];
+    double fn[10], fd[10]; //same for fd and gd
+    double gn[11], gd[11];
+
+    //polynomial, for the approximate version
+    double approxSn[7];
+    double approxCn[7];
+    double approxFn[8];
+    double approxGn[8];
+};
+extern const FresnelCoefficients fresnelCoefficients;
+
+//The AVX2 and AVX-512 kernels.  They only do something if their files are compiled for those instruction sets,
+//which avx2FresnelCompiled() and avx512FresnelCompiled() tell.
+bool avx2FresnelCompiled();
+void fresnelManyAVX2(int n, const double *t, double *outS, double *outC);
+void fresnelApproxManyAVX2(int n, const double *t, double *outS, double *outC);
+
+bool avx512FresnelCompiled();
+void fresnelManyAVX512(int n, const double *t, double *outS, double *outC);
+void fresnelApproxManyAVX512(int n, const double *t, double *outS, double *outC);
+
+}
+
+#endif //CORNUCOPIA_FRESNELKERNELS_H_INCLUDED
@@ -0,0 +1,115 @@
+/*--
+    FresnelKernelsAVX2.cpp  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//This file is compiled with AVX2 and FMA enabled (see CMakeLists.txt), and its functions are only called on
+//processors that have them.  See the note in ProjectionKernelsAVX2.cpp about what it may include.
+
+#include "FresnelKernels.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+#include <immintrin.h>
+
+namespace Cornu
+{
+namespace
+{
+
+struct AVX2Ops
+{
+    typedef __m256d Packet;
+    typedef __m256d Mask;
+    enum { size = 4 };
+
+    static Packet set1(double v) { return _mm256_set1_pd(v); }
+    static Packet add(Packet a, Packet b) { return _mm256_add_pd(a, b); }
+    static Packet sub(Packet a, Packet b) { return _mm256_sub_pd(a, b); }
+    static Packet mul(Packet a, Packet b) { return _mm256_mul_pd(a, b); }
+    static Packet div(Packet a, Packet b) { return _mm256_div_pd(a, b); }
+    static Packet fmadd(Packet a, Packet b, Packet c) { return _mm256_fmadd_pd(a, b, c); }
+    static Packet neg(Packet a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.)); }
+    static Packet abs(Packet a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.), a); }
+    static Packet copySignBit(Packet a, Packet from) { return _mm256_xor_pd(a, _mm256_and_pd(from, _mm256_set1_pd(-0.))); }
+    static Packet round(Packet a) { return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    static Packet floor(Packet a) { return _mm256_floor_pd(a); }
+
+    static Mask less(Packet a, Packet b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static Packet blend(Packet ifFalse, Packet ifTrue, Mask m) { return _mm256_blendv_pd(ifFalse, ifTrue, m); }
+    static bool any(Mask m) { return _mm256_movemask_pd(m) != 0; }
+    static bool all(Mask m) { return _mm256_movemask_pd(m) == 0xf; }
+
+    static Packet load(const double *p, int count) //count values, padded with zeros
+    {
+        if(count == size)
+            return _mm256_loadu_pd(p);
+        double buf[size] = { 0., 0., 0., 0. };
+        for(int i = 0; i < count; ++i)
+            buf[i] = p[i];
+        return _mm256_loadu_pd(buf);
+    }
+
+    static void store(double *p, Packet v, int count)
+    {
+        if(count == size)
+        {
+            _mm256_storeu_pd(p, v);
+            return;
+        }
+        double buf[size];
+        _mm256_storeu_pd(buf, v);
+        for(int i = 0; i < count; ++i)
+            p[i] = buf[i];
+    }
+};
+
+} //namespace
+}
+
+#include "FresnelKernelsImpl.h"
+
+namespace Cornu
+{
+
+bool avx2FresnelCompiled() { return true; }
+
+void fresnelManyAVX2(int n, const double *t, double *outS, double *outC)
+{
+    fresnelManyImpl<AVX2Ops, false>(n, t, outS, outC);
+}
+
+void fresnelApproxManyAVX2(int n, const double *t, double *outS, double *outC)
+{
+    fresnelManyImpl<AVX2Ops, true>(n, t, outS, outC);
+}
+
+}
+
+#else //not compiled for AVX2--the kernels are never called
+
+namespace Cornu
+{
+
+bool avx2FresnelCompiled() { return false; }
+void fresnelManyAVX2(int, const double *, double *, double *) {}
+void fresnelApproxManyAVX2(int, const double *, double *, double *) {}
+
+}
+
+#endif
@@ -0,0 +1,107 @@
+/*--
+    FresnelKernelsAVX512.cpp  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//This file is compiled with AVX-512 enabled (see CMakeLists.txt), and its functions are only called on processors
+//that have it.  See the note in ProjectionKernelsAVX2.cpp about what it may include.
+
+#include "FresnelKernels.h"
+
+#if defined(__AVX512F__)
+
+#include <immintrin.h>
+
+namespace Cornu
+{
+namespace
+{
+
+struct AVX512Ops
+{
+    typedef __m512d Packet;
+    typedef __mmask8 Mask;
+    enum { size = 8 };
+
+    static Packet set1(double v) { return _mm512_set1_pd(v); }
+    static Packet add(Packet a, Packet b) { return _mm512_add_pd(a, b); }
+    static Packet sub(Packet a, Packet b) { return _mm512_sub_pd(a, b); }
+    static Packet mul(Packet a, Packet b) { return _mm512_mul_pd(a, b); }
+    static Packet div(Packet a, Packet b) { return _mm512_div_pd(a, b); }
+    static Packet fmadd(Packet a, Packet b, Packet c) { return _mm512_fmadd_pd(a, b, c); }
+    static Packet neg(Packet a) { return _mm512_sub_pd(_mm512_setzero_pd(), a); }
+    static Packet abs(Packet a) { return _mm512_abs_pd(a); }
+    static Packet copySignBit(Packet a, Packet from)
+    {
+        __m512i sign = _mm512_and_epi64(_mm512_castpd_si512(from), _mm512_set1_epi64((long long)0x8000000000000000ULL));
+        return _mm512_castsi512_pd(_mm512_xor_epi64(_mm512_castpd_si512(a), sign));
+    }
+    //the zero-masked form, because GCC expands the unmasked one with an undefined passthrough that it then warns about
+    static Packet round(Packet a) { return _mm512_maskz_roundscale_pd((__mmask8)0xff, a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    static Packet floor(Packet a) { return _mm512_maskz_roundscale_pd((__mmask8)0xff, a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+
+    static Mask less(Packet a, Packet b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+    static Packet blend(Packet ifFalse, Packet ifTrue, Mask m) { return _mm512_mask_blend_pd(m, ifFalse, ifTrue); }
+    static bool any(Mask m) { return m != 0; }
+    static bool all(Mask m) { return m == 0xff; }
+
+    static Packet load(const double *p, int count) //count values, padded with zeros
+    {
+        return _mm512_maskz_loadu_pd((__mmask8)((1 << count) - 1), p);
+    }
+
+    static void store(double *p, Packet v, int count)
+    {
+        _mm512_mask_storeu_pd(p, (__mmask8)((1 << count) - 1), v);
+    }
+};
+
+} //namespace
+}
+
+#include "FresnelKernelsImpl.h"
+
+namespace Cornu
+{
+
+bool avx512FresnelCompiled() { return true; }
+
+void fresnelManyAVX512(int n, const double *t, double *outS, double *outC)
+{
+    fresnelManyImpl<AVX512Ops, false>(n, t, outS, outC);
+}
+
+void fresnelApproxManyAVX512(int n, const double *t, double *outS, double *outC)
+{
+    fresnelManyImpl<AVX512Ops, true>(n, t, outS, outC);
+}
+
+}
+
+#else //not compiled for AVX-512--the kernels are never called
+
+namespace Cornu
+{
+
+bool avx512FresnelCompiled() { return false; }
+void fresnelManyAVX512(int, const double *, double *, double *) {}
+void fresnelApproxManyAVX512(int, const double *, double *, double *) {}
+
+}
+
+#endif
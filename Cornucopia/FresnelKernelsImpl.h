@@ -0,0 +1,178 @@
+/*--
+    FresnelKernelsImpl.h  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_FRESNELKERNELSIMPL_H_INCLUDED
+#define CORNUCOPIA_FRESNELKERNELSIMPL_H_INCLUDED
+
+//The Fresnel kernels, written once for the packet types of FresnelKernelsAVX2.cpp and FresnelKernelsAVX512.cpp.
+//Each of those defines a struct with the packet type, its size and its operations, and instantiates fresnelManyImpl
+//with it.  Everything here has internal linkage, so that the instantiations for different instruction sets can't
+//be mixed up by the linker.
+
+#include "FresnelKernels.h"
+
+namespace Cornu
+{
+namespace
+{
+
+//Cephes's polevl and p1evl, with the coefficients highest degree first
+template<typename Ops>
+inline typename Ops::Packet polevlv(typename Ops::Packet x, const double *coef, int size)
+{
+    typename Ops::Packet ans = Ops::set1(coef[0]);
+    for(int i = 1; i < size; ++i)
+        ans = Ops::fmadd(ans, x, Ops::set1(coef[i]));
+    return ans;
+}
+
+template<typename Ops>
+inline typename Ops::Packet p1evlv(typename Ops::Packet x, const double *coef, int size) //leading coef is 1
+{
+    typename Ops::Packet ans = Ops::add(x, Ops::set1(coef[0]));
+    for(int i = 1; i < size; ++i)
+        ans = Ops::fmadd(ans, x, Ops::set1(coef[i]));
+    return ans;
+}
+
+//Sine and cosine of pi/2 * x2.  Subtracting the nearest integer from x2 is exact, so the reduction adds no error
+//beyond that of x2 itself, whatever its size.  What remains is within pi/4 of zero and goes into Cephes's polynomials.
+template<typename Ops>
+inline void sinCosHalfPi(typename Ops::Packet x2, typename Ops::Packet &outSin, typename Ops::Packet &outCos)
+{
+    typedef typename Ops::Packet Packet;
+    typedef typename Ops::Mask Mask;
+
+    Packet k = Ops::round(x2);
+    Packet r = Ops::mul(Ops::sub(x2, k), Ops::set1(1.5707963267948966192));
+    Packet z = Ops::mul(r, r);
+
+    Packet sinCoef = Ops::set1(1.58962301576546568060E-10);
+    sinCoef = Ops::fmadd(sinCoef, z, Ops::set1(-2.50507477628578072866E-8));
+    sinCoef = Ops::fmadd(sinCoef, z, Ops::set1(2.75573136213857245213E-6));
+    sinCoef = Ops::fmadd(sinCoef, z, Ops::set1(-1.98412698295895385996E-4));
+    sinCoef = Ops::fmadd(sinCoef, z, Ops::set1(8.33333333332211858878E-3));
+    sinCoef = Ops::fmadd(sinCoef, z, Ops::set1(-1.66666666666666307295E-1));
+    Packet sinR = Ops::fmadd(Ops::mul(r, z), sinCoef, r);
+
+    Packet cosCoef = Ops::set1(-1.13585365213876817300E-11);
+    cosCoef = Ops::fmadd(cosCoef, z, Ops::set1(2.08757008419747316778E-9));
+    cosCoef = Ops::fmadd(cosCoef, z, Ops::set1(-2.75573141792967388112E-7));
+    cosCoef = Ops::fmadd(cosCoef, z, Ops::set1(2.48015872888517045348E-5));
+    cosCoef = Ops::fmadd(cosCoef, z, Ops::set1(-1.38888888888730564116E-3));
+    cosCoef = Ops::fmadd(cosCoef, z, Ops::set1(4.16666666666665929218E-2));
+    Packet cosR = Ops::fmadd(Ops::mul(z, z), cosCoef, Ops::fmadd(Ops::set1(-0.5), z, Ops::set1(1.)));
+
+    //k mod 4 is the quadrant
+    Packet quadrant = Ops::sub(k, Ops::mul(Ops::set1(4.), Ops::floor(Ops::mul(k, Ops::set1(0.25)))));
+    Packet odd = Ops::sub(quadrant, Ops::mul(Ops::set1(2.), Ops::floor(Ops::mul(quadrant, Ops::set1(0.5)))));
+    Mask swap = Ops::less(Ops::set1(0.5), odd); //quadrants 1 and 3
+    Mask negSin = Ops::less(Ops::set1(1.5), quadrant); //quadrants 2 and 3
+    Mask negCos = Ops::less(Ops::abs(Ops::sub(quadrant, Ops::set1(1.5))), Ops::set1(1.)); //quadrants 1 and 2
+
+    Packet s = Ops::blend(sinR, cosR, swap), c = Ops::blend(cosR, sinR, swap);
+    outSin = Ops::blend(s, Ops::neg(s), negSin);
+    outCos = Ops::blend(c, Ops::neg(c), negCos);
+}
+
+//The same branches as the scalar fresnel and fresnelApprox in Fresnel.cpp.  Only the branches that some of the
+//values need are computed.
+template<typename Ops, bool approx>
+inline void fresnelPacket(typename Ops::Packet xxa, typename Ops::Packet &outS, typename Ops::Packet &outC)
+{
+    typedef typename Ops::Packet Packet;
+    typedef typename Ops::Mask Mask;
+    const FresnelCoefficients &coef = fresnelCoefficients;
+
+    Packet x = Ops::abs(xxa);
+    Packet x2 = Ops::mul(x, x);
+    Mask low = Ops::less(x2, Ops::set1(2.5625));
+
+    Packet ss = Ops::set1(0.), cc = Ops::set1(0.);
+    if(Ops::any(low))
+    {
+        Packet t = Ops::mul(x2, x2);
+        Packet x3 = Ops::mul(x, x2);
+        if(approx)
+        {
+            ss = Ops::mul(x3, polevlv<Ops>(t, coef.approxSn, 7));
+            cc = Ops::mul(x, polevlv<Ops>(t, coef.approxCn, 7));
+        }
+        else
+        {
+            ss = Ops::div(Ops::mul(x3, polevlv<Ops>(t, coef.sn, 6)), p1evlv<Ops>(t, coef.sd, 6));
+            cc = Ops::div(Ops::mul(x, polevlv<Ops>(t, coef.cn, 6)), polevlv<Ops>(t, coef.cd, 7));
+        }
+    }
+    if(!Ops::all(low))
+    {
+        //asymptotic power series auxiliary functions for large argument
+        Packet t = Ops::div(Ops::set1(1.), Ops::mul(Ops::set1(3.14159265358979323846), x2));
+        Packet u = Ops::mul(t, t);
+        Packet f, g;
+        if(approx)
+        {
+            f = Ops::sub(Ops::set1(1.), Ops::mul(u, polevlv<Ops>(u, coef.approxFn, 8)));
+            g = Ops::mul(t, polevlv<Ops>(u, coef.approxGn, 8));
+        }
+        else
+        {
+            f = Ops::sub(Ops::set1(1.), Ops::div(Ops::mul(u, polevlv<Ops>(u, coef.fn, 10)), p1evlv<Ops>(u, coef.fd, 10)));
+            g = Ops::div(Ops::mul(t, polevlv<Ops>(u, coef.gn, 11)), p1evlv<Ops>(u, coef.gd, 11));
+        }
+
+        Packet s, c;
+        sinCosHalfPi<Ops>(x2, s, c);
+
+        Packet invPiX = Ops::div(Ops::set1(0.31830988618379067154), x);
+        Packet half = Ops::set1(0.5);
+        Packet highC = Ops::fmadd(invPiX, Ops::sub(Ops::mul(f, s), Ops::mul(g, c)), half);
+        Packet highS = Ops::sub(half, Ops::mul(invPiX, Ops::fmadd(f, c, Ops::mul(g, s))));
+
+        Mask huge = Ops::less(Ops::set1(36974.0), x);
+        highC = Ops::blend(highC, half, huge);
+        highS = Ops::blend(highS, half, huge);
+
+        ss = Ops::blend(highS, ss, low);
+        cc = Ops::blend(highC, cc, low);
+    }
+
+    //the values for positive x aren't negative, so this negates them for negative x
+    outS = Ops::copySignBit(ss, xxa);
+    outC = Ops::copySignBit(cc, xxa);
+}
+
+template<typename Ops, bool approx>
+void fresnelManyImpl(int n, const double *t, double *outS, double *outC)
+{
+    for(int i = 0; i < n; i += Ops::size)
+    {
+        int count = (n - i < Ops::size) ? n - i : Ops::size;
+        typename Ops::Packet s, c;
+        fresnelPacket<Ops, approx>(Ops::load(t + i, count), s, c);
+        Ops::store(outS + i, s, count);
+        Ops::store(outC + i, c, count);
+    }
+}
+
+} //namespace
+}
+
+#endif //CORNUCOPIA_FRESNELKERNELSIMPL_H_INCLUDED
@@ -265,6 +265,16 @@ class DefaultGraphConstructor : public Algorithm<GRAPH_CONSTRUCTION>
 public:
     string name() const { return "Default"; }
 
+    //override
+    vector<ParameterDependency> dependencies() const
+    {
+        vector<ParameterDependency> out; //these are all read by the CostEvaluator
+        for(int i = Parameters::LINE_COST; i <= Parameters::INFLECTION_COST; ++i)
+            out.push_back(ParameterDependency(Parameters::ParameterType(i)));
+        out.push_back(ParameterDependency(Parameters::SHORTNESS_THRESHOLD));
+        return out;
+    }
+
 protected:
     void _run(const Fitter &fitter, AlgorithmOutput<GRAPH_CONSTRUCTION> &out)
     {
@@ -317,6 +327,8 @@ protected:
 
         for(int i = 0; i < (int)primitives.size(); ++i)
         {
+            if(fitter.cancelled())
+                return;
             if(primitives[i].isEndCurve()) //no edges from end curves
                 continue;
 
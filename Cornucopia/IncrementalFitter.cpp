@@ -0,0 +1,172 @@
+/*--
+    IncrementalFitter.cpp  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "IncrementalFitter.h"
+#include "Polyline.h"
+#include "PrimitiveSequence.h"
+#include "Oversketcher.h"
+
+using namespace std;
+using namespace Eigen;
+NAMESPACE_Cornu
+
+IncrementalFitter::IncrementalFitter()
+    : _points(0, NOT_CIRCULAR), _windowStart(0), _dirty(false), _commitLength(400.), _keepLength(150.)
+{
+}
+
+void IncrementalFitter::setParams(const Parameters &params)
+{
+    _fitter.setParams(params);
+    _committed = _frozen = _anchor = PrimitiveSequenceConstPtr();
+    _windowStart = 0;
+    _dirty = true;
+}
+
+void IncrementalFitter::clear()
+{
+    _points.clear();
+    _committed = _frozen = _anchor = PrimitiveSequenceConstPtr();
+    _output = PrimitiveSequenceConstPtr();
+    _windowStart = 0;
+    _dirty = false;
+}
+
+void IncrementalFitter::addPoint(const Vector2d &pt)
+{
+    if(!_points.empty() && _points.back() == pt) //duplicate points carry no information
+        return;
+    _points.push_back(pt);
+    _dirty = true;
+}
+
+void IncrementalFitter::addPoints(const VectorC<Vector2d> &pts)
+{
+    for(int i = 0; i < pts.size(); ++i)
+        addPoint(pts[i]);
+}
+
+PrimitiveSequenceConstPtr IncrementalFitter::update()
+{
+    if(!_dirty)
+        return _output;
+    _dirty = false;
+
+    if(_points.size() - _windowStart < 2)
+    {
+        _output = _committed;
+        return _output;
+    }
+
+    VectorC<Vector2d> window(_points.size() - _windowStart, NOT_CIRCULAR);
+    for(int i = 0; i < window.size(); ++i)
+        window[i] = _points[_windowStart + i];
+
+    _fitter.setOversketchBase(_anchor);
+    _fitter.setOriginalSketch(new Polyline(window));
+    _fitter.run();
+
+    PrimitiveSequenceConstPtr windowOutput = _fitter.finalOutput();
+    bool commit = _fitter.originalSketch()->length() > _commitLength * _fitter.params().get(Parameters::PIXEL_SIZE);
+
+    if(_anchor && (!windowOutput || !_attached()))
+    {
+        //the window came back near the anchor, didn't start near it, or couldn't be fit with it--just append the fit
+        //and try again later
+        if(!commit)
+        {
+            _output = windowOutput ? _concatenate(_committed, windowOutput) : _committed;
+            return _output;
+        }
+
+        //but don't let the window grow without bound: fit it on its own and commit it after the committed curve
+        _fitter.setOversketchBase(PrimitiveSequenceConstPtr());
+        _fitter.run();
+        windowOutput = _fitter.finalOutput();
+        _frozen = _committed;
+        _anchor = PrimitiveSequenceConstPtr();
+    }
+
+    if(!windowOutput) //keep showing what has been committed until the window fits again
+    {
+        _output = _committed;
+        return _output;
+    }
+
+    _output = _concatenate(_frozen, windowOutput);
+
+    if(commit)
+        _commit(windowOutput);
+
+    return _output;
+}
+
+void IncrementalFitter::_commit(PrimitiveSequenceConstPtr windowOutput)
+{
+    if(windowOutput->isClosed())
+        return;
+
+    //find the last window point that has at least keepLength of the window after it
+    PolylineConstPtr window = _fitter.originalSketch();
+    double keep = _keepLength * _fitter.params().get(Parameters::PIXEL_SIZE);
+    int idx = window->paramToIdx(window->length() - keep);
+    if(idx <= 0)
+        return;
+
+    const vector<double> &params = _fitter.originalSketchToFinalParameters();
+    double commitParam = params[idx];
+    if(commitParam <= 0. || commitParam >= windowOutput->length())
+        return;
+
+    _committed = _concatenate(_frozen, windowOutput->trimmed(0, commitParam));
+    _windowStart += idx;
+
+    //only the last keepLength of the committed curve is given to the oversketcher, so that the window can't
+    //get attached anywhere else
+    double anchorStart = _committed->length() - keep;
+    if(anchorStart > 0.)
+    {
+        _frozen = _committed->trimmed(0, anchorStart);
+        _anchor = _committed->trimmed(anchorStart, _committed->length());
+    }
+    else
+    {
+        _frozen = PrimitiveSequenceConstPtr();
+        _anchor = _committed;
+    }
+}
+
+bool IncrementalFitter::_attached() const
+{
+    smart_ptr<const AlgorithmOutput<OVERSKETCHING> > oversketch = _fitter.output<OVERSKETCHING>();
+    return oversketch->toPrepend && !oversketch->toAppend && !oversketch->finallyClose;
+}
+
+PrimitiveSequenceConstPtr IncrementalFitter::_concatenate(PrimitiveSequenceConstPtr first, PrimitiveSequenceConstPtr second)
+{
+    if(!first)
+        return second;
+
+    VectorC<CurvePrimitiveConstPtr> primitives(first->primitives(), NOT_CIRCULAR);
+    primitives.insert(primitives.end(), second->primitives().begin(), second->primitives().end());
+    return new PrimitiveSequence(primitives);
+}
+
+END_NAMESPACE_Cornu
@@ -0,0 +1,84 @@
+/*--
+    IncrementalFitter.h  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_INCREMENTALFITTER_H_INCLUDED
+#define CORNUCOPIA_INCREMENTALFITTER_H_INCLUDED
+
+#include "defs.h"
+#include "Fitter.h"
+#include "VectorC.h"
+
+NAMESPACE_Cornu
+
+//Fits a stroke while it is being drawn.  Refitting the whole stroke after every new point costs O(n) per point,
+//so instead the beginning of the fit is frozen once it is far enough from the pen ("committed") and only a
+//trailing window of points is refit, using the end of the committed curve as the oversketch base.  The oversketching
+//stage peels back and blends that end, so the window attaches to it smoothly.  If the window doesn't attach (or can't
+//be fit with the anchor), it is fit on its own and committed after the committed curve (with a G0 join) once it gets
+//long enough.  The per-point cost is thus bounded by the window size rather than by the stroke length.
+//The result is close to, but not the same as, fitting the complete stroke--rerun a regular Fitter when the
+//stroke is finished if the exact result is needed.
+class IncrementalFitter
+{
+public:
+    IncrementalFitter();
+
+    const Parameters &params() const { return _fitter.params(); }
+    void setParams(const Parameters &params); //refits from scratch on the next update
+
+    void setDebugging(Debugging *debugging) { _fitter.setDebugging(debugging); }
+
+    //When the arclength of the window exceeds commitLength, the fit of all but the last keepLength of it gets committed.
+    //Both lengths are in pixels (i.e., multiplied by Parameters::PIXEL_SIZE).
+    void setWindowLengths(double commitLength, double keepLength) { _commitLength = commitLength; _keepLength = keepLength; }
+
+    void clear();
+    void addPoint(const Eigen::Vector2d &pt);
+    void addPoints(const VectorC<Eigen::Vector2d> &pts);
+
+    //Fits the window if points were added since the last call and returns the fit of the whole stroke so far.
+    //If the window is too short or its fit fails, returns just the committed curve (null if nothing is committed yet).
+    PrimitiveSequenceConstPtr update();
+
+    const VectorC<Eigen::Vector2d> &points() const { return _points; }
+    int windowStart() const { return _windowStart; } //index of the first point that is still being refit
+    PrimitiveSequenceConstPtr committed() const { return _committed; }
+
+private:
+    void _commit(PrimitiveSequenceConstPtr windowOutput);
+    bool _attached() const; //whether the last window fit continues the anchor (and nothing else)
+    static PrimitiveSequenceConstPtr _concatenate(PrimitiveSequenceConstPtr first, PrimitiveSequenceConstPtr second);
+
+    Fitter _fitter;
+    VectorC<Eigen::Vector2d> _points;
+    int _windowStart;
+    PrimitiveSequenceConstPtr _committed;
+    PrimitiveSequenceConstPtr _frozen; //the part of _committed before the anchor, which the window fit never sees
+    PrimitiveSequenceConstPtr _anchor; //the end of _committed, used as the oversketch base for the window
+    PrimitiveSequenceConstPtr _output;
+    bool _dirty;
+
+    double _commitLength;
+    double _keepLength;
+};
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_INCREMENTALFITTER_H_INCLUDED
@@ -19,6 +19,7 @@
 */
 
 #include "Line.h"
+#include "ProjectionKernels.h"
 
 using namespace std;
 using namespace Eigen;
@@ -59,6 +60,18 @@ double Line::project(const Vec &point) const
     return min(_length(), max(0., _der.dot(point - _startPos())));
 }
 
+void Line::projectMany(int n, const double *x, const double *y, double *outS) const
+{
+    LineKernelData line = { _params[X], _params[Y], _der[0], _der[1], _length() };
+    projectLineMany(line, n, x, y, outS);
+}
+
+void Line::distanceSqMany(int n, const double *x, const double *y, double *outDistSq) const
+{
+    LineKernelData line = { _params[X], _params[Y], _der[0], _der[1], _length() };
+    distanceSqLineMany(line, n, x, y, outDistSq);
+}
+
 void Line::eval(double s, Vec *pos, Vec *der, Vec *der2) const
 {
     if(pos)
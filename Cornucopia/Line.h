@@ -23,6 +23,7 @@
 
 #include "defs.h"
 #include "CurvePrimitive.h"
+#include "Pool.h"
 
 NAMESPACE_Cornu
 
@@ -38,6 +39,8 @@ public:
     void eval(double s, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const;
 
     double project(const Vec &point) const;
+    void projectMany(int n, const double *x, const double *y, double *outS) const;
+    void distanceSqMany(int n, const double *x, const double *y, double *outDistSq) const;
 
     Vec pos(double s) const { return _startPos() + s * _der; }
     Vec der(double s) const { return _der; }
@@ -58,7 +61,7 @@ public:
     void derivativeAt(double s, ParamDer &out, ParamDer &outTan) const;
     void derivativeAtEnd(int continuity, EndDer &out) const;
 
-    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    CORNU_POOLED_OPERATOR_NEW
 protected:
     //override
     void _paramsChanged() { _der = Vec(cos(_startAngle()), sin(_startAngle())); }
@@ -0,0 +1,112 @@
+/*--
+    MemoryTracking.cpp  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "MemoryTracking.h"
+
+#ifdef CORNU_TRACK_ALLOCATIONS
+
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+namespace
+{
+    CORNU_THREAD_LOCAL long long threadAllocated = 0;
+    CORNU_THREAD_LOCAL long long threadPeak = 0;
+
+    //every block is preceded by its size, padded so that the block stays 16-byte aligned
+    const size_t headerSize = 16;
+
+    void *trackedAlloc(size_t size)
+    {
+        char *block = (char *)malloc(size + headerSize);
+        if(!block)
+            return NULL;
+        *(size_t *)block = size;
+        threadAllocated += (long long)size;
+        if(threadAllocated > threadPeak)
+            threadPeak = threadAllocated;
+        return block + headerSize;
+    }
+
+    void trackedFree(void *ptr)
+    {
+        if(!ptr)
+            return;
+        char *block = (char *)ptr - headerSize;
+        threadAllocated -= (long long)*(size_t *)block;
+        free(block);
+    }
+
+    void *trackedNew(size_t size)
+    {
+        for(;;)
+        {
+            void *out = trackedAlloc(size == 0 ? 1 : size);
+            if(out)
+                return out;
+            new_handler handler = set_new_handler(0);
+            set_new_handler(handler);
+            if(!handler)
+                throw bad_alloc();
+            handler();
+        }
+    }
+}
+
+#if __cplusplus >= 201103L
+#define CORNU_THROWS_BAD_ALLOC
+#define CORNU_THROWS_NOTHING noexcept
+#else
+#define CORNU_THROWS_BAD_ALLOC throw(std::bad_alloc)
+#define CORNU_THROWS_NOTHING throw()
+#endif
+
+void *operator new(size_t size) CORNU_THROWS_BAD_ALLOC { return trackedNew(size); }
+void *operator new[](size_t size) CORNU_THROWS_BAD_ALLOC { return trackedNew(size); }
+void *operator new(size_t size, const nothrow_t &) CORNU_THROWS_NOTHING { return trackedAlloc(size == 0 ? 1 : size); }
+void *operator new[](size_t size, const nothrow_t &) CORNU_THROWS_NOTHING { return trackedAlloc(size == 0 ? 1 : size); }
+void operator delete(void *ptr) CORNU_THROWS_NOTHING { trackedFree(ptr); }
+void operator delete[](void *ptr) CORNU_THROWS_NOTHING { trackedFree(ptr); }
+void operator delete(void *ptr, const nothrow_t &) CORNU_THROWS_NOTHING { trackedFree(ptr); }
+void operator delete[](void *ptr, const nothrow_t &) CORNU_THROWS_NOTHING { trackedFree(ptr); }
+
+NAMESPACE_Cornu
+
+bool isAllocationTrackingEnabled() { return true; }
+long long allocatedBytes() { return threadAllocated; }
+long long peakAllocatedBytes() { return threadPeak; }
+void resetPeakAllocatedBytes() { threadPeak = threadAllocated; }
+
+END_NAMESPACE_Cornu
+
+#else //CORNU_TRACK_ALLOCATIONS
+
+NAMESPACE_Cornu
+
+bool isAllocationTrackingEnabled() { return false; }
+long long allocatedBytes() { return 0; }
+long long peakAllocatedBytes() { return 0; }
+void resetPeakAllocatedBytes() {}
+
+END_NAMESPACE_Cornu
+
+#endif //CORNU_TRACK_ALLOCATIONS
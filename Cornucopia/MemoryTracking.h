@@ -0,0 +1,40 @@
+/*--
+    MemoryTracking.h  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_MEMORYTRACKING_H_INCLUDED
+#define CORNUCOPIA_MEMORYTRACKING_H_INCLUDED
+
+#include "defs.h"
+
+NAMESPACE_Cornu
+
+//Opt-in heap usage measurement for FitStats.  When the library is built with CORNU_TRACK_ALLOCATIONS defined,
+//it replaces the global operator new and delete with versions that count the bytes each thread allocates and
+//frees (so memory freed by a different thread than the one that allocated it is attributed to the freeing one).
+//Otherwise all of these return zero.
+
+bool isAllocationTrackingEnabled();
+long long allocatedBytes(); //bytes allocated minus bytes freed by the current thread
+long long peakAllocatedBytes(); //maximum of allocatedBytes() since the last resetPeakAllocatedBytes() on this thread
+void resetPeakAllocatedBytes();
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_MEMORYTRACKING_H_INCLUDED
@@ -34,6 +34,14 @@ class DefaultOversketcher : public Algorithm<OVERSKETCHING>
 public:
     string name() const { return "Default"; }
 
+    //override
+    vector<ParameterDependency> dependencies() const
+    {
+        vector<ParameterDependency> out;
+        out.push_back(ParameterDependency(Parameters::OVERSKETCH_THRESHOLD));
+        return out;
+    }
+
 protected:
     void _run(const Fitter &fitter, AlgorithmOutput<OVERSKETCHING> &out)
     {
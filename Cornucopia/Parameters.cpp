@@ -20,6 +20,7 @@
 
 #include "Parameters.h"
 #include "Algorithm.h"
+#include "Threading.h"
 
 using namespace std;
 using namespace Eigen;
@@ -34,13 +35,21 @@ Parameters::Parameters(const string &name)
         _values[i] = _parameters[i].defaultVal;
 }
 
+static OnceFlag parametersInitialized = CORNU_ONCE_INIT;
+static OnceFlag presetsInitialized = CORNU_ONCE_INIT;
+
 void Parameters::_initializeParameters()
 {
-    static bool initialized = false;
-    if(initialized)
-        return;
-    initialized = true;
+    callOnce(parametersInitialized, &_createParameters);
+}
 
+void Parameters::_initializePresets()
+{
+    callOnce(presetsInitialized, &_createPresets);
+}
+
+void Parameters::_createParameters()
+{
     _parameters.push_back(Parameter(LINE_COST, "Line cost", 0., 20., 7.5));
     _parameters.push_back(Parameter(ARC_COST, "Arc cost", 0., 30., 9.));
     _parameters.push_back(Parameter(CLOTHOID_COST, "Clothoid cost", 0., 50., 15.));
@@ -75,15 +84,12 @@ void Parameters::_initializeParameters()
     _parameters.push_back(Parameter(REDUCE_GRAPH_EVERY, "Reduce Graph Every", 10.));
     _parameters.push_back(Parameter(COMBINE_DAMPING, "Combine Damping", 2.));
     _parameters.push_back(Parameter(OVERSKETCH_THRESHOLD, "Oversketch Threshold", 15.));
+    _parameters.push_back(Parameter(TRUST_REGION_SOLVER, "Trust Region Solver (bool)", 0.));
+    _parameters.push_back(Parameter(GEODESIC_ACCELERATION, "Geodesic Acceleration (bool)", 0.));
 }
 
-void Parameters::_initializePresets()
+void Parameters::_createPresets()
 {
-    static bool initialized = false;
-    if(initialized)
-        return;
-    initialized = true;
-
     _initializeParameters();
 
     _presets.resize(NUM_PRESETS);
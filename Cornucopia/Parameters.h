@@ -75,7 +75,9 @@ public:
         CURVE_ADJUST_DAMPING, //How much regularization is added to the solver for edge validation--increasing this makes the solver more stable, but converge slower
         REDUCE_GRAPH_EVERY, //How many invalid paths are found before the A* heuristic is recomputed.  Setting this too high or too low hurts performance.
         COMBINE_DAMPING, //How much regularization is added to the solver for the final combine--increasing this makes the solver more stable, but converge slower
-        OVERSKETCH_THRESHOLD //How far the endpoints need to be from the base curve for them to be considered on the curve
+        OVERSKETCH_THRESHOLD, //How far the endpoints need to be from the base curve for them to be considered on the curve
+        TRUST_REGION_SOLVER, //If nonzero, the solvers adapt the damping to how well each step is predicted instead of halving steps that increase the error
+        GEODESIC_ACCELERATION //If nonzero, the trust region solvers add a second-order correction to each step (where the problem supports it)
     };
 
     enum Preset
@@ -130,8 +132,10 @@ public:
     static const std::vector<Parameters> &presets() { _initializePresets(); return _presets; }
 
 private:
-    static void _initializeParameters(); 
+    static void _initializeParameters(); //thread-safe, only the first call does anything
     static void _initializePresets(); 
+    static void _createParameters();
+    static void _createPresets();
     static std::vector<Parameter> _parameters;
     static std::vector<Parameters> _presets;
 };
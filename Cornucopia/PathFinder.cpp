@@ -62,9 +62,11 @@ public:
         if(_validated)
             return true;
         _validated = true;
+        ++fitter.runningStats().edgesValidated;
         float newCost = _edge->validatedCost(fitter);
         if(newCost > _cost)
         {
+            ++fitter.runningStats().edgesInvalidated;
             //Debugging::get()->printf("Inv");
             _reducedCost += newCost - _cost;
             _cost = newCost;
@@ -110,42 +112,33 @@ public:
             _vData[edges[i].endVtx].numIncoming++;
     }
 
-    vector<int> shortestPath()
+    //Finding the path is iterative: each step finds the shortest path (or cycle) and validates its edges, which may
+    //raise their costs, until the path found is valid.  start() sets up the search and step() does one iteration,
+    //returning true once result() is final.
+    void start(bool cycle)
     {
-        vector<int> sources;
-        for(int i = 0; i < (int)_vertices.size(); ++i)
-        {
-            if(_vertices[i].source)
-                sources.push_back(i);
-            _vData[i].source = _vertices[i].source;
-            _vData[i].target = _vertices[i].target;
-        }
-
-        int reduceEvery = max(1, (int)_fitter.params().get(Parameters::REDUCE_GRAPH_EVERY));
-        vector<int> sp;
-
-        for(int i = 0; i < _maxIter; ++i)
+        _cycle = cycle;
+        _iter = 0;
+        _cycleRound = 0;
+        _reduceEvery = max(1, (int)_fitter.params().get(Parameters::REDUCE_GRAPH_EVERY));
+        _sp.clear();
+        _sources.clear();
+
+        if(!cycle)
         {
-            if(i % reduceEvery == 0)
-                _reduceForPath(sources);
-
-            sp = _shortestPath(sources);
-
-            if(_validatePath(sp))
-                break;
+            for(int i = 0; i < (int)_vertices.size(); ++i)
+            {
+                if(_vertices[i].source)
+                    _sources.push_back(i);
+                _vData[i].source = _vertices[i].source;
+                _vData[i].target = _vertices[i].target;
+            }
+            return;
         }
 
-        //debugging output
-        double total = 0;
-        for(int j = 0; j < (int)sp.size(); ++j)
-            total += _eData[sp[j]].cost();
-        Debugging::get()->printf("Found path, len = %d, cost = %lf", sp.size(), total);
-
-        return sp;
-    }
+        if(_edges.empty()) //no cycle to find--step() finishes right away with an empty result
+            return;
 
-    vector<int> shortestCycle()
-    {
         //start with the vertex that has an edge both cheap and with very connected vertices
         double minEdgeCost = Parameters::infinity;
         size_t bestEdge = 0;
@@ -160,44 +153,74 @@ public:
             }
         }
 
-        vector<int> sources(1, _edges[bestEdge].startVtx);
-
-        int reduceEvery = max(1, (int)_fitter.params().get(Parameters::REDUCE_GRAPH_EVERY));
+        _sources.push_back(_edges[bestEdge].startVtx);
+        _vData[_sources[0]].source = _vData[_sources[0]].target = true;
+    }
 
-        vector<int> sp;
+    bool step()
+    {
+        if(_fitter.cancelled())
+        {
+            _sp.clear();
+            return true;
+        }
 
-        for(int iter = 0; iter < 2; ++iter)
+        if(!_cycle)
         {
-            _vData[sources[0]].source = _vData[sources[0]].target = true;
+            if(_iter % _reduceEvery == 0)
+                _reduceForPath(_sources);
 
-            for(int i = 0; i < _maxIter; ++i)
-            {
-                if(i % reduceEvery == 0)
-                    _reduceForCycle(sources[0]);
+            _sp = _shortestPath(_sources);
+            ++_fitter.runningStats().pathFinderIterations;
 
-                sp = _shortestPath(sources);
+            if(!_validatePath(_sp) && ++_iter < _maxIter)
+                return false;
 
-                if(sp.empty()) //should not happen
-                    return sp;
+            //debugging output
+            double total = 0;
+            for(int j = 0; j < (int)_sp.size(); ++j)
+                total += _eData[_sp[j]].cost();
+            Debugging::get()->printf("Found path, len = %d, cost = %lf", _sp.size(), total);
 
-                if(_validatePath(sp))
-                    break;
-            }
+            return true;
+        }
 
-            _vData[sources[0]].source = _vData[sources[0]].target = false;
+        if(_sources.empty())
+            return true;
 
-            sources[0] = _edges[sp[sp.size() / 2]].endVtx; //the new source is the middlemost vertex
+        if(_iter % _reduceEvery == 0)
+            _reduceForCycle(_sources[0]);
 
-            //debugging output
-            double total = 0;
-            for(int j = 0; j < (int)sp.size(); ++j)
-                total += _eData[sp[j]].cost();
-            Debugging::get()->printf("Found cycle, len = %d, cost = %lf", sp.size(), total);
-        }
+        _sp = _shortestPath(_sources);
+        ++_fitter.runningStats().pathFinderIterations;
+
+        if(_sp.empty()) //should not happen
+            return true;
+
+        if(!_validatePath(_sp) && ++_iter < _maxIter)
+            return false;
 
-        return sp;
+        //the cycle is found twice, the second time starting from the middle of the first one
+        _vData[_sources[0]].source = _vData[_sources[0]].target = false;
+
+        _sources[0] = _edges[_sp[_sp.size() / 2]].endVtx; //the new source is the middlemost vertex
+
+        //debugging output
+        double total = 0;
+        for(int j = 0; j < (int)_sp.size(); ++j)
+            total += _eData[_sp[j]].cost();
+        Debugging::get()->printf("Found cycle, len = %d, cost = %lf", _sp.size(), total);
+
+        if(++_cycleRound == 2)
+            return true;
+
+        _iter = 0;
+        _vData[_sources[0]].source = _vData[_sources[0]].target = true;
+        return false;
     }
 
+    const vector<int> &result() const { return _sp; }
+
 private:
     static const int _maxIter = 10000;
 
@@ -403,6 +426,14 @@ private:
     vector<PathFindingEdgeData> _eData;
     vector<PathFindingVertexData> _vData;
     const Fitter &_fitter;
+
+    //search state
+    bool _cycle;
+    int _iter;
+    int _cycleRound;
+    int _reduceEvery;
+    vector<int> _sources;
+    vector<int> _sp;
 };
 
 class DefaultPathFinder : public Algorithm<PATH_FINDING>
@@ -410,22 +441,71 @@ class DefaultPathFinder : public Algorithm<PATH_FINDING>
 public:
     string name() const { return "Default"; }
 
+    //override
+    vector<ParameterDependency> dependencies() const
+    {
+        vector<ParameterDependency> out;
+        out.push_back(ParameterDependency(Parameters::REDUCE_GRAPH_EVERY));
+        //edge validation runs twoCurveCombine
+        out.push_back(ParameterDependency(Parameters::TWO_CURVE_CURVATURE_ADJUST));
+        out.push_back(ParameterDependency(Parameters::CURVE_ADJUST_DAMPING));
+        out.push_back(ParameterDependency(Parameters::TRUST_REGION_SOLVER));
+        out.push_back(ParameterDependency(Parameters::GEODESIC_ACCELERATION));
+        out.push_back(ParameterDependency(Parameters::INFLECTION_COST, ParameterDependency::POSITIVITY));
+        return out;
+    }
+
+    //override
+    AlgorithmTaskPtr startTask(const Fitter &fitter)
+    {
+        return new Task(fitter, new AlgorithmOutput<PATH_FINDING>());
+    }
+
 protected:
     void _run(const Fitter &fitter, AlgorithmOutput<PATH_FINDING> &out)
     {
         smart_ptr<const AlgorithmOutput<GRAPH_CONSTRUCTION> > graph = fitter.output<GRAPH_CONSTRUCTION>();
-        const vector<FitPrimitive> &primitives = fitter.output<PRIMITIVE_FITTING>()->primitives;
 
         //construct the path finding graph
         PathFindingGraph pfgraph(graph->vertices, graph->edges, fitter);
-        
-        bool closed = fitter.output<CURVE_CLOSING>()->closed;
 
-        vector<int> shortestPath;
-        if(closed)
-            shortestPath = pfgraph.shortestCycle();
-        else
-            shortestPath = pfgraph.shortestPath();
+        pfgraph.start(fitter.output<CURVE_CLOSING>()->closed);
+        while(!pfgraph.step())
+            ;
+
+        _finish(fitter, pfgraph.result(), out);
+    }
+
+private:
+    //resumable path finding, one path finding iteration per step
+    class Task : public AlgorithmTaskTemplate<PATH_FINDING>
+    {
+    public:
+        Task(const Fitter &fitter, AlgorithmOutput<PATH_FINDING> *out)
+            : AlgorithmTaskTemplate<PATH_FINDING>(fitter, out),
+              _graph(fitter.output<GRAPH_CONSTRUCTION>()->vertices, fitter.output<GRAPH_CONSTRUCTION>()->edges, fitter)
+        {
+            _graph.start(fitter.output<CURVE_CLOSING>()->closed);
+        }
+
+        //override
+        bool step()
+        {
+            if(!_graph.step())
+                return false;
+            _finish(_fitter, _graph.result(), *_out);
+            return true;
+        }
+
+    private:
+        PathFindingGraph _graph;
+    };
+
+    static void _finish(const Fitter &fitter, const vector<int> &shortestPath, AlgorithmOutput<PATH_FINDING> &out)
+    {
+        smart_ptr<const AlgorithmOutput<GRAPH_CONSTRUCTION> > graph = fitter.output<GRAPH_CONSTRUCTION>();
+        const vector<FitPrimitive> &primitives = fitter.output<PRIMITIVE_FITTING>()->primitives;
+        bool closed = fitter.output<CURVE_CLOSING>()->closed;
 
         //debugging output
         ostringstream ss;
@@ -24,6 +24,7 @@
 #include "defs.h"
 #include "Curve.h"
 #include "VectorC.h"
+#include "Pool.h"
 
 NAMESPACE_Cornu
 
@@ -56,6 +57,7 @@ public:
 
     const VectorC<Eigen::Vector2d> &pts() const { return _pts; }
 
+    CORNU_POOLED_OPERATOR_NEW
 private:
     VectorC<Eigen::Vector2d> _pts;
     //lengths[x] = \sum_{i=1}^{i=x} ||pts[i]-pts[i-1]||, i.e., length up to point x
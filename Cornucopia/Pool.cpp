@@ -0,0 +1,190 @@
+/*--
+    Pool.cpp  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Pool.h"
+#include "Threading.h"
+#include <new>
+
+using namespace std;
+NAMESPACE_Cornu
+
+namespace
+{
+    const size_t granularity = 16; //block sizes are multiples of this, which is also the alignment
+    const int numSizes = 32; //so the largest pooled block is 512 bytes
+    const int batchSize = 64; //blocks moved to or from the depot at a time
+    const int maxThreadBlocks = 4 * batchSize; //free blocks of a size a thread keeps before giving some back
+    const size_t chunkSize = 16384;
+
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    CORNU_THREAD_LOCAL FreeBlock *threadLists[numSizes];
+    CORNU_THREAD_LOCAL int threadCounts[numSizes];
+    CORNU_THREAD_LOCAL bool threadHookArmed; //the thread's free lists will go to the depot when it exits
+
+    struct Depot
+    {
+        Depot() { for(int i = 0; i < numSizes; ++i) lists[i] = NULL; }
+
+        Mutex mutex;
+        FreeBlock *lists[numSizes];
+    };
+
+    Depot *depot = NULL;
+    ThreadExitHook *threadExitHook = NULL;
+    OnceFlag depotCreated = CORNU_ONCE_INIT;
+
+    //moves all of the exiting thread's free blocks to the depot, so the blocks (and the chunks they are carved
+    //from) can be used by other threads
+    void releaseThreadLists()
+    {
+        threadHookArmed = false;
+
+        ScopedLock lock(depot->mutex);
+        for(int c = 0; c < numSizes; ++c)
+        {
+            FreeBlock *first = threadLists[c];
+            if(!first)
+                continue;
+            FreeBlock *last = first;
+            while(last->next)
+                last = last->next;
+            last->next = depot->lists[c];
+            depot->lists[c] = first;
+            threadLists[c] = NULL;
+            threadCounts[c] = 0;
+        }
+    }
+
+    void createDepot()
+    {
+        depot = new Depot();
+        threadExitHook = new ThreadExitHook(&releaseThreadLists);
+    }
+
+    //called before a thread puts its first block on its free lists
+    void armThreadHook()
+    {
+        callOnce(depotCreated, &createDepot);
+        threadExitHook->arm();
+        threadHookArmed = true;
+    }
+
+    //large blocks come from the heap, with the offset to the start of the allocation stored before them
+    void *alignedAllocate(size_t size)
+    {
+        char *raw = (char *)::operator new(size + granularity);
+        char *out = raw + granularity - (size_t(raw) % granularity);
+        out[-1] = char(out - raw);
+        return out;
+    }
+
+    void alignedFree(void *ptr)
+    {
+        char *out = (char *)ptr;
+        ::operator delete(out - out[-1]);
+    }
+
+    //gets free blocks of size class c into the thread's list, either from the depot or from a new chunk
+    void refill(int c)
+    {
+        if(!threadHookArmed)
+            armThreadHook();
+
+        {
+            ScopedLock lock(depot->mutex);
+            FreeBlock *&list = depot->lists[c];
+            for(int i = 0; i < batchSize && list; ++i)
+            {
+                FreeBlock *block = list;
+                list = block->next;
+                block->next = threadLists[c];
+                threadLists[c] = block;
+                ++threadCounts[c];
+            }
+        }
+        if(threadLists[c])
+            return;
+
+        size_t blockSize = (c + 1) * granularity;
+        char *chunk = (char *)alignedAllocate(chunkSize);
+        for(size_t offset = 0; offset + blockSize <= chunkSize; offset += blockSize)
+        {
+            FreeBlock *block = (FreeBlock *)(chunk + offset);
+            block->next = threadLists[c];
+            threadLists[c] = block;
+            ++threadCounts[c];
+        }
+    }
+
+    //moves a batch of the thread's free blocks of size class c to the depot
+    void giveBack(int c)
+    {
+        FreeBlock *first = threadLists[c], *last = first;
+        for(int i = 1; i < batchSize; ++i)
+            last = last->next;
+        threadLists[c] = last->next;
+        threadCounts[c] -= batchSize;
+
+        ScopedLock lock(depot->mutex);
+        last->next = depot->lists[c];
+        depot->lists[c] = first;
+    }
+}
+
+void *poolAllocate(size_t size)
+{
+    if(size > numSizes * granularity)
+        return alignedAllocate(size);
+
+    int c = size == 0 ? 0 : int((size - 1) / granularity);
+    if(!threadLists[c])
+        refill(c);
+
+    FreeBlock *block = threadLists[c];
+    threadLists[c] = block->next;
+    --threadCounts[c];
+    return block;
+}
+
+void poolFree(void *ptr, size_t size)
+{
+    if(!ptr)
+        return;
+    if(size > numSizes * granularity)
+    {
+        alignedFree(ptr);
+        return;
+    }
+
+    int c = size == 0 ? 0 : int((size - 1) / granularity);
+    if(!threadHookArmed) //the block may have been allocated on another thread
+        armThreadHook();
+    FreeBlock *block = (FreeBlock *)ptr;
+    block->next = threadLists[c];
+    threadLists[c] = block;
+    if(++threadCounts[c] > maxThreadBlocks)
+        giveBack(c);
+}
+
+END_NAMESPACE_Cornu
@@ -0,0 +1,50 @@
+/*--
+    Pool.h  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_POOL_H_INCLUDED
+#define CORNUCOPIA_POOL_H_INCLUDED
+
+#include "defs.h"
+#include <cstddef>
+
+NAMESPACE_Cornu
+
+//A thread-caching allocator for the small objects a fit creates by the thousand (curve primitives in particular).
+//Each thread allocates from and frees to its own free lists, so threads fitting at the same time don't contend
+//on the heap; a thread with too many free blocks of a size passes a batch of them to a shared depot, where
+//threads that run out take them from, and a thread that exits passes all of its free blocks there.  Blocks are
+//16-byte aligned.  The memory is reused but never returned to the system, so the pool stays as large as the most
+//objects ever alive at once.
+void *poolAllocate(size_t size);
+void poolFree(void *ptr, size_t size); //size must be the one that was passed to poolAllocate
+
+END_NAMESPACE_Cornu
+
+//Put in the public section of a class to allocate its objects from the pool.  It replaces
+//EIGEN_MAKE_ALIGNED_OPERATOR_NEW, as the pool provides the alignment fixed-size Eigen members need.
+#define CORNU_POOLED_OPERATOR_NEW \
+    static void *operator new(size_t size) { return Cornu::poolAllocate(size); } \
+    static void *operator new[](size_t size) { return Cornu::poolAllocate(size); } \
+    static void operator delete(void *ptr, size_t size) { Cornu::poolFree(ptr, size); } \
+    static void operator delete[](void *ptr, size_t size) { Cornu::poolFree(ptr, size); } \
+    static void *operator new(size_t, void *ptr) { return ptr; } \
+    static void operator delete(void *, void *) {}
+
+#endif //CORNUCOPIA_POOL_H_INCLUDED
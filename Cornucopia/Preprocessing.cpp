@@ -49,6 +49,17 @@ class AdaptiveScaleDetector : public Algorithm<SCALE_DETECTION>
 public:
     string name() const { return "Adaptive"; }
 
+    //override
+    vector<ParameterDependency> dependencies() const
+    {
+        vector<ParameterDependency> out;
+        out.push_back(ParameterDependency(Parameters::PIXEL_SIZE));
+        out.push_back(ParameterDependency(Parameters::SMALL_CURVE_PIXELS));
+        out.push_back(ParameterDependency(Parameters::LARGE_CURVE_PIXELS));
+        out.push_back(ParameterDependency(Parameters::MAX_RESCALE));
+        return out;
+    }
+
 protected:
     void _run(const Fitter &fitter, AlgorithmOutput<SCALE_DETECTION> &out)
     {
@@ -87,6 +98,15 @@ class DefaultPrelimResampling : public Algorithm<PRELIM_RESAMPLING>
 public:
     string name() const { return "Default"; }
 
+    //override
+    vector<ParameterDependency> dependencies() const
+    {
+        vector<ParameterDependency> out;
+        out.push_back(ParameterDependency(Parameters::MIN_PRELIM_LENGTH));
+        out.push_back(ParameterDependency(Parameters::DP_CUTOFF));
+        return out;
+    }
+
 protected:
     void _run(const Fitter &fitter, AlgorithmOutput<PRELIM_RESAMPLING> &out)
     {
@@ -230,6 +250,14 @@ class OldCurveCloser : public Algorithm<CURVE_CLOSING>
 public:
     string name() const { return "Old"; }
 
+    //override
+    vector<ParameterDependency> dependencies() const
+    {
+        vector<ParameterDependency> out;
+        out.push_back(ParameterDependency(Parameters::CLOSEDNESS_THRESHOLD));
+        return out;
+    }
+
 protected:
     void _run(const Fitter &fitter, AlgorithmOutput<CURVE_CLOSING> &out)
     {
@@ -165,7 +165,9 @@ ClothoidPtr ClothoidFitter::getCurve() const
 
     lhs = _getLhs(_totalLength);
 
-    Vector4d abcd = lhs.inverse() * _rhs;
+    //the normal equations are badly conditioned, so solve them instead of inverting (an explicit 4x4 inverse loses
+    //all precision under -ffast-math)
+    Vector4d abcd = lhs.ldlt().solve(_rhs);
     return getClothoidWithParams(abcd);
 }
 
@@ -184,7 +186,7 @@ ClothoidPtr ClothoidFitter::getCurveWithZeroCurvature(double param) const
            constraint.transpose(),  0;
     rhs << _rhs, 0;
 
-    Vector4d abcd = (lhs.inverse() * rhs).head<4>();
+    Vector4d abcd = lhs.partialPivLu().solve(rhs).head<4>();
     return getClothoidWithParams(abcd);
 }
 
@@ -289,4 +291,89 @@ Vector4d ClothoidFitter::_getRhs(double x, double y, double z)
     return out;
 }
 
+SpanMoments::Moments SpanMoments::Moments::operator+(const Moments &o) const
+{
+    Moments out;
+    out.w = w + o.w; out.x = x + o.x; out.y = y + o.y;
+    out.xx = xx + o.xx; out.xy = xy + o.xy; out.yy = yy + o.yy;
+    out.xq = xq + o.xq; out.yq = yq + o.yq; out.qq = qq + o.qq;
+    return out;
+}
+
+SpanMoments::Moments SpanMoments::Moments::operator-(const Moments &o) const
+{
+    Moments out;
+    out.w = w - o.w; out.x = x - o.x; out.y = y - o.y;
+    out.xx = xx - o.xx; out.xy = xy - o.xy; out.yy = yy - o.yy;
+    out.xq = xq - o.xq; out.yq = yq - o.yq; out.qq = qq - o.qq;
+    return out;
+}
+
+SpanMoments::SpanMoments(PolylineConstPtr poly) : _origin(Vector2d::Zero())
+{
+    const VectorC<Vector2d> &pts = poly->pts();
+    for(int i = 0; i < pts.size(); ++i)
+        _origin += pts[i];
+    _origin /= max(1, (int)pts.size());
+
+    _prefix.resize(pts.size() + 1);
+    for(int i = 0; i < pts.size(); ++i)
+    {
+        //the same weights as the L2 error computer's
+        VectorC<Vector2d>::Circulator prev = --pts.circulator(i);
+        VectorC<Vector2d>::Circulator next = ++pts.circulator(i);
+        double w = (prev.done() ? 0 : poly->lengthFromTo(prev.index(), i)) + (next.done() ? 0 : poly->lengthFromTo(i, next.index()));
+
+        Vector2d p = pts[i] - _origin;
+        double q = p.squaredNorm();
+
+        Moments &m = _prefix[i + 1];
+        m = _prefix[i];
+        m.w += w;
+        m.x += w * p[0];
+        m.y += w * p[1];
+        m.xx += w * p[0] * p[0];
+        m.xy += w * p[0] * p[1];
+        m.yy += w * p[1] * p[1];
+        m.xq += w * p[0] * q;
+        m.yq += w * p[1] * q;
+        m.qq += w * q * q;
+    }
+}
+
+SpanMoments::Moments SpanMoments::_span(int from, int to) const
+{
+    if(from <= to)
+        return _prefix[to + 1] - _prefix[from];
+    return (_prefix.back() - _prefix[from]) + _prefix[to + 1]; //wraps around
+}
+
+double SpanMoments::algebraicDistance(const CurvePrimitive &curve, const Vector2d &pt)
+{
+    //For a circle through a with unit normal n at a (pointing toward the center) and curvature k, this is
+    //(k/2)(|p - c|^2 - r^2) = (k/2)|p - a|^2 - n.(p - a), which becomes the signed distance to the line when k = 0.
+    double angle = curve.startAngle();
+    Vector2d normal(-sin(angle), cos(angle));
+    Vector2d p = pt - curve.startPos();
+    return 0.5 * curve.startCurvature() * p.squaredNorm() - normal.dot(p);
+}
+
+double SpanMoments::algebraicError(const CurvePrimitive &curve, int from, int to) const
+{
+    Moments m = _span(from, to);
+
+    //the algebraic distance as a polynomial in the point coordinates (about the origin): a q + b.p + c
+    double angle = curve.startAngle();
+    Vector2d normal(-sin(angle), cos(angle));
+    Vector2d start = curve.startPos() - _origin;
+    double a = 0.5 * curve.startCurvature();
+    Vector2d b = -2. * a * start - normal;
+    double c = a * start.squaredNorm() + normal.dot(start);
+
+    double out = SQR(a) * m.qq + 2. * a * (b[0] * m.xq + b[1] * m.yq) + 2. * a * c * (m.xx + m.yy)
+                 + SQR(b[0]) * m.xx + 2. * b[0] * b[1] * m.xy + SQR(b[1]) * m.yy
+                 + 2. * c * (b[0] * m.x + b[1] * m.y) + SQR(c) * m.w;
+    return max(0., out); //it can come out slightly negative because of roundoff
+}
+
 END_NAMESPACE_Cornu
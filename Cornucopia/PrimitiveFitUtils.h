@@ -29,6 +29,7 @@
 #include "Line.h"
 #include "Arc.h"
 #include "Clothoid.h"
+#include "Polyline.h"
 
 NAMESPACE_Cornu
 
@@ -118,6 +119,41 @@ private:
     double _totalLength;
 };
 
+//Prefix sums of moments of the points of a polyline, each weighted by the length of polyline around it (as in the
+//L2 error), for measuring the error of a line or arc on any span of points in constant time.
+//Spans are from from to to, inclusive, and wrap around on closed polylines.
+class SpanMoments : public smart_base
+{
+public:
+    SpanMoments(PolylineConstPtr poly);
+
+    //The weighted sum of squared algebraic distances from the points to the line or circle that the line or arc lies
+    //on.  The algebraic distance is d(1 + kd/2) for a point at distance d from a curve with curvature k, so it is close
+    //to the true distance for points that are near the curve relative to its radius.
+    double algebraicError(const CurvePrimitive &curve, int from, int to) const;
+    static double algebraicDistance(const CurvePrimitive &curve, const Eigen::Vector2d &pt);
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+private:
+    //weighted sums of the powers of the coordinates, where q = x^2 + y^2
+    struct Moments
+    {
+        Moments() : w(0.), x(0.), y(0.), xx(0.), xy(0.), yy(0.), xq(0.), yq(0.), qq(0.) {}
+
+        Moments operator+(const Moments &o) const;
+        Moments operator-(const Moments &o) const;
+
+        double w, x, y, xx, xy, yy, xq, yq, qq;
+    };
+
+    Moments _span(int from, int to) const;
+
+    Eigen::Vector2d _origin; //the moments are about the centroid of the points to keep the sums well-conditioned
+    std::vector<Moments> _prefix; //_prefix[i] is the sum over the points before i
+};
+
+CORNU_SMART_TYPEDEFS(SpanMoments);
+
 END_NAMESPACE_Cornu
 
 #endif //CORNUCOPIA_PRIMITIVEFITUTILS_H_INCLUDED
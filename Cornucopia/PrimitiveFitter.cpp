@@ -26,49 +26,43 @@
 #include "ErrorComputer.h"
 #include "Solver.h"
 #include "Oversketcher.h"
+#include "Threading.h"
 
 using namespace std;
 using namespace Eigen;
 NAMESPACE_Cornu
 
-class OneCurveProblem : public LSProblem
+class OneCurveProblem : public LSProblemFixed<6>
 {
 public:
     OneCurveProblem(const FitPrimitive &primitive, ErrorComputerConstPtr errorComputer)
         : _primitive(primitive), _errorComputer(errorComputer)  {}
 
     //overrides
-    double error(const VectorXd &x, LSEvalData *)
+    double error(const Vec &x)
     {
         setParams(x);
         return _errorComputer->computeError(_primitive.curve, _primitive.startIdx, _primitive.endIdx);
     }
 
-    LSEvalData *createEvalData()
+    void eval(const Vec &x, VectorXd &outErr, MatrixXd &outErrDer)
     {
-        return new LSDenseEvalData();
-    }
-    void eval(const VectorXd &x, LSEvalData *data)
-    {
-        LSDenseEvalData *curveData = static_cast<LSDenseEvalData *>(data);
         setParams(x);
-        MatrixXd &errDer = curveData->errDerRef();
-        _errorComputer->computeErrorVector(_primitive.curve, _primitive.startIdx, _primitive.endIdx,
-                                           curveData->errVectorRef(), &errDer);
+        _errorComputer->computeErrorVector(_primitive.curve, _primitive.startIdx, _primitive.endIdx, outErr, &outErrDer);
 
-        _primitive.curve->toEndCurvatureDerivative(errDer);
+        _primitive.curve->toEndCurvatureDerivative(outErrDer);
     }
 
-    VectorXd params() const
+    Vec params() const
     {
         if(_primitive.curve->getType() != CurvePrimitive::CLOTHOID)
             return _primitive.curve->params();
-        VectorXd out = _primitive.curve->params();
+        Vec out = _primitive.curve->params();
         out(CurvePrimitive::DCURVATURE) = out(CurvePrimitive::CURVATURE) + out(CurvePrimitive::LENGTH) * out(CurvePrimitive::DCURVATURE);
         return out;
     }
 
-    void setParams(const VectorXd &x)
+    void setParams(const Vec &x)
     {
         if(_primitive.curve->getType() != CurvePrimitive::CLOTHOID)
         {
@@ -76,7 +70,7 @@ public:
             return;
         }
 
-        VectorXd xm = x;
+        Vec xm = x;
         xm(CurvePrimitive::DCURVATURE) = (xm(CurvePrimitive::DCURVATURE) - xm(CurvePrimitive::CURVATURE)) / xm(CurvePrimitive::LENGTH);
         _primitive.curve->setParams(xm);
     }
@@ -93,12 +87,128 @@ public:
 
     string name() const { return _adjust ? "Adjust" : "Default"; }
 
+    //override
+    vector<ParameterDependency> dependencies() const
+    {
+        vector<ParameterDependency> out;
+        out.push_back(ParameterDependency(Parameters::ERROR_THRESHOLD));
+        out.push_back(ParameterDependency(Parameters::INFLECTION_COST, ParameterDependency::POSITIVITY));
+        //only whether a primitive type is allowed at all matters here--the costs themselves are used by the graph
+        out.push_back(ParameterDependency(Parameters::LINE_COST, ParameterDependency::FINITENESS));
+        out.push_back(ParameterDependency(Parameters::ARC_COST, ParameterDependency::FINITENESS));
+        out.push_back(ParameterDependency(Parameters::CLOTHOID_COST, ParameterDependency::FINITENESS));
+        if(_adjust)
+        {
+            out.push_back(ParameterDependency(Parameters::CURVE_ADJUST_DAMPING));
+            out.push_back(ParameterDependency(Parameters::TRUST_REGION_SOLVER));
+            out.push_back(ParameterDependency(Parameters::GEODESIC_ACCELERATION));
+        }
+        return out;
+    }
+
 private:
     bool _adjust;
 
+    //Resumable primitive fitting: the first step fits the curves continuing the oversketched curve, then each step
+    //fits the primitives from one start point
+    class Task : public AlgorithmTaskTemplate<PRIMITIVE_FITTING>
+    {
+    public:
+        Task(const DefaultPrimitiveFitter *algorithm, const Fitter &fitter, AlgorithmOutput<PRIMITIVE_FITTING> *out)
+            : AlgorithmTaskTemplate<PRIMITIVE_FITTING>(fitter, out), _algorithm(algorithm), _next(-1) {}
+
+        //override
+        bool step()
+        {
+            if(_next < 0)
+                _algorithm->_fitFixed(_fitter, *_out);
+            else
+                _algorithm->_fitFrom(_next, _fitter, _out->primitives, _fitter.runningStats());
+            return ++_next >= _fitter.output<RESAMPLING>()->output->pts().size();
+        }
+
+    private:
+        const DefaultPrimitiveFitter *_algorithm;
+        int _next; //start point to fit from in the next step
+    };
+
+public:
+    //override
+    AlgorithmTaskPtr startTask(const Fitter &fitter)
+    {
+        return new Task(this, fitter, new AlgorithmOutput<PRIMITIVE_FITTING>());
+    }
+
 protected:
 
     void _run(const Fitter &fitter, AlgorithmOutput<PRIMITIVE_FITTING> &out)
+    {
+        _fitFixed(fitter, out);
+
+        int numPts = fitter.output<RESAMPLING>()->output->pts().size();
+        if(fitter.numThreads() != 1)
+        {
+            ParallelFit task(this, fitter, numPts);
+            parallelFor(task, numPts, fitter.numThreads());
+            task.merge(out);
+            return;
+        }
+
+        for(int i = 0; i < numPts; ++i) //iterate over start points
+        {
+            if(fitter.cancelled())
+                return;
+            fitter.reportProgress(PRIMITIVE_FITTING, double(i) / double(numPts));
+
+            _fitFrom(i, fitter, out.primitives, fitter.runningStats());
+        }
+    }
+
+private:
+    //Fits from the start points on several threads.  The primitives from each start point go into a separate
+    //buffer, and the buffers are appended in start point order, so the output is identical to the serial one.
+    class ParallelFit : public ParallelTask
+    {
+    public:
+        ParallelFit(const DefaultPrimitiveFitter *algorithm, const Fitter &fitter, int numPts)
+            : _algorithm(algorithm), _fitter(fitter), _primitives(numPts), _stats(numPts), _numDone(0) {}
+
+        //override
+        void run(int index)
+        {
+            if(_fitter.cancelled())
+                return;
+
+            _algorithm->_fitFrom(index, _fitter, _primitives[index], _stats[index]);
+
+            ScopedLock lock(_progressMutex);
+            _fitter.reportProgress(PRIMITIVE_FITTING, double(++_numDone) / double(_primitives.size()));
+        }
+
+        void merge(AlgorithmOutput<PRIMITIVE_FITTING> &out) const
+        {
+            for(int i = 0; i < (int)_primitives.size(); ++i)
+            {
+                out.primitives.insert(out.primitives.end(), _primitives[i].begin(), _primitives[i].end());
+                _fitter.runningStats().solverIterations += _stats[i].solverIterations;
+                _fitter.runningStats().solverHalvings += _stats[i].solverHalvings;
+                _fitter.runningStats().solverRejections += _stats[i].solverRejections;
+            }
+        }
+
+    private:
+        ParallelFit &operator=(const ParallelFit &);
+
+        const DefaultPrimitiveFitter *_algorithm;
+        const Fitter &_fitter;
+        vector<vector<FitPrimitive> > _primitives; //indexed by start point
+        vector<FitStats> _stats; //the solver counts for each start point
+        Mutex _progressMutex;
+        int _numDone;
+    };
+
+    //fits the primitives that continue the curves oversketching kept from the base curve
+    void _fitFixed(const Fitter &fitter, AlgorithmOutput<PRIMITIVE_FITTING> &out) const
     {
         const VectorC<bool> &corners = fitter.output<RESAMPLING>()->corners;
         PolylineConstPtr poly = fitter.output<RESAMPLING>()->output;
@@ -108,8 +218,6 @@ protected:
         const VectorC<Vector2d> &pts = poly->pts();
 
         const double errorThreshold = fitter.scaledParameter(Parameters::ERROR_THRESHOLD);
-        std::string typeNames[3] = { "Lines", "Arcs", "Clothoids" };
-        bool inflectionAccounting = fitter.params().get(Parameters::INFLECTION_COST) > 0.;
 
         if(osOutput->startCurve)
         {
@@ -134,7 +242,7 @@ protected:
                 fit.curve->trim(0, fit.curve->project(pts[i]));
 
                 fit.endCurvSign = (fit.curve->endCurvature() >= 0) ? 1 : -1;
-                fit.error = errorComputer->computeErrorForCost(fit.curve, 0, fit.endIdx, false);
+                fit.error = errorComputer->computeErrorForCostBounded(fit.curve, 0, fit.endIdx, errorThreshold * errorThreshold, false);
 
                 fit.numPts++;
 
@@ -173,7 +281,8 @@ protected:
                 fit.curve->trim(fit.curve->project(pts[i]), fit.curve->length());
 
                 fit.startCurvSign = (fit.curve->startCurvature() >= 0) ? 1 : -1;
-                fit.error = errorComputer->computeErrorForCost(fit.curve, fit.startIdx, (int)pts.size() - 1, true, false);
+                fit.error = errorComputer->computeErrorForCostBounded(fit.curve, fit.startIdx, (int)pts.size() - 1,
+                                                                 errorThreshold * errorThreshold, true, false);
 
                 fit.numPts++;
 
@@ -188,106 +297,118 @@ protected:
                     break; //don't pull curve past corner
             }
         }
+    }
+
+    //fits the primitives starting at point i, counting the solver work in stats; safe to call concurrently
+    void _fitFrom(int i, const Fitter &fitter, vector<FitPrimitive> &out, FitStats &stats) const
+    {
+        const VectorC<bool> &corners = fitter.output<RESAMPLING>()->corners;
+        PolylineConstPtr poly = fitter.output<RESAMPLING>()->output;
+        ErrorComputerConstPtr errorComputer = fitter.output<ERROR_COMPUTER>()->errorComputer;
+
+        const VectorC<Vector2d> &pts = poly->pts();
+
+        const double errorThreshold = fitter.scaledParameter(Parameters::ERROR_THRESHOLD);
+        std::string typeNames[3] = { "Lines", "Arcs", "Clothoids" };
+        bool inflectionAccounting = fitter.params().get(Parameters::INFLECTION_COST) > 0.;
 
-        for(int i = 0; i < pts.size(); ++i) //iterate over start points
+        LineFitter lineFitter;
+        ArcFitter arcFitter;
+        ClothoidFitter clothoidFitter;
+        FitterBase *fitters[3] = { &lineFitter, &arcFitter, &clothoidFitter };
+
+        for(int type = 0; type <= 2; ++type) //iterate over lines, arcs, clothoids
         {
-            FitterBasePtr fitters[3];
-            fitters[0] = new LineFitter();
-            fitters[1] = new ArcFitter();
-            fitters[2] = new ClothoidFitter();
+            int fitSoFar = 0;
+
+            bool needType = fitter.params().get(Parameters::ParameterType(Parameters::LINE_COST + type)) < Parameters::infinity;
+            ErrorTrackerPtr errorTracker = errorComputer->tracker(i);
 
-            for(int type = 0; type <= 2; ++type) //iterate over lines, arcs, clothoids
+            for(VectorC<Vector2d>::Circulator circ = pts.circulator(i); !circ.done(); ++circ)
             {
-                int fitSoFar = 0;
+                ++fitSoFar;
 
-                bool needType = fitter.params().get(Parameters::ParameterType(Parameters::LINE_COST + type)) < Parameters::infinity;
+                if(!needType && (type == 2 || fitSoFar >= 3 + type)) //if we don't need primitives of this type
+                    break;
 
-                for(VectorC<Vector2d>::Circulator circ = pts.circulator(i); !circ.done(); ++circ)
+                fitters[type]->addPoint(*circ);
+                if(fitSoFar >= 2 + type) //at least two points per line, etc.
                 {
-                    ++fitSoFar;
+                    CurvePrimitivePtr curve = fitters[type]->getPrimitive();
+                    Vector3d color(0, 0, 0);
+                    color[type] = 1;
 
-                    if(!needType && (type == 2 || fitSoFar >= 3 + type)) //if we don't need primitives of this type
-                        break;
+                    FitPrimitive fit;
+                    fit.curve = curve;
+                    fit.startIdx = i;
+                    fit.endIdx = circ.index();
+                    fit.numPts = fitSoFar;
+                    fit.startCurvSign = (curve->startCurvature() >= 0) ? 1 : -1;
+                    fit.endCurvSign = (curve->endCurvature() >= 0) ? 1 : -1;
 
-                    fitters[type]->addPoint(*circ);
-                    if(fitSoFar >= 2 + type) //at least two points per line, etc.
-                    {
-                        CurvePrimitivePtr curve = fitters[type]->getPrimitive();
-                        Vector3d color(0, 0, 0);
-                        color[type] = 1;
-
-                        FitPrimitive fit;
-                        fit.curve = curve;
-                        fit.startIdx = i;
-                        fit.endIdx = circ.index();
-                        fit.numPts = fitSoFar;
-                        fit.startCurvSign = (curve->startCurvature() >= 0) ? 1 : -1;
-                        fit.endCurvSign = (curve->endCurvature() >= 0) ? 1 : -1;
-
-                        if(_adjust)
-                            adjustPrimitive(fit, fitter);
+                    if(_adjust)
+                        adjustPrimitive(fit, fitter, stats);
 
-                        fit.error = errorComputer->computeErrorForCost(curve, i, fit.endIdx);
+                    fit.error = errorTracker->computeErrorForCostBounded(curve, fit.endIdx, errorThreshold * errorThreshold);
 
-                        double length = poly->lengthFromTo(i, fit.endIdx);
-                        if(fit.error > errorThreshold * errorThreshold)
-                            break;
+                    double length = poly->lengthFromTo(i, fit.endIdx);
+                    if(fit.error > errorThreshold * errorThreshold)
+                        break;
 
-                        //Debugging::get()->drawCurve(curve, color, typeNames[type]);
-                        out.primitives.push_back(fit);
+                    //Debugging::get()->drawCurve(curve, color, typeNames[type]);
+                    out.push_back(fit);
 
-                        if(type == 0 && inflectionAccounting) //line with "opposite" curvature
-                        {
-                            fit.startCurvSign = -fit.startCurvSign;
-                            fit.endCurvSign = -fit.endCurvSign;
-                            out.primitives.push_back(fit);
-                        }
+                    if(type == 0 && inflectionAccounting) //line with "opposite" curvature
+                    {
+                        fit.startCurvSign = -fit.startCurvSign;
+                        fit.endCurvSign = -fit.endCurvSign;
+                        out.push_back(fit);
+                    }
 
-                        //if different start and end curvatures
-                        if(fit.startCurvSign != fit.endCurvSign && inflectionAccounting)
-                        {
-                            double start = poly->idxToParam(i);
-                            double end = poly->idxToParam(fit.endIdx);
-                            CurvePrimitivePtr startNoCurv = static_pointer_cast<ClothoidFitter>(fitters[2])->getCurveWithZeroCurvature(0);
-                            CurvePrimitivePtr endNoCurv = static_pointer_cast<ClothoidFitter>(fitters[2])->getCurveWithZeroCurvature(end - start);
+                    //if different start and end curvatures
+                    if(fit.startCurvSign != fit.endCurvSign && inflectionAccounting)
+                    {
+                        double start = poly->idxToParam(i);
+                        double end = poly->idxToParam(fit.endIdx);
+                        CurvePrimitivePtr startNoCurv = clothoidFitter.getCurveWithZeroCurvature(0);
+                        CurvePrimitivePtr endNoCurv = clothoidFitter.getCurveWithZeroCurvature(end - start);
 
-                            fit.curve = startNoCurv;
-                            fit.startCurvSign = fit.endCurvSign = (startNoCurv->endCurvature() > 0. ? 1 : -1);
+                        fit.curve = startNoCurv;
+                        fit.startCurvSign = fit.endCurvSign = (startNoCurv->endCurvature() > 0. ? 1 : -1);
 
-                            if(_adjust)
-                                adjustPrimitive(fit, fitter);
+                        if(_adjust)
+                            adjustPrimitive(fit, fitter, stats);
 
-                            fit.error = errorComputer->computeErrorForCost(fit.curve, i, fit.endIdx);
+                        fit.error = errorComputer->computeErrorForCostBounded(fit.curve, i, fit.endIdx, errorThreshold * errorThreshold);
 
-                            if(fit.error < errorThreshold * errorThreshold)
-                            {
-                                out.primitives.push_back(fit);
-                                //Debugging::get()->drawCurve(fit.curve, color, typeNames[type]);
-                            }
+                        if(fit.error < errorThreshold * errorThreshold)
+                        {
+                            out.push_back(fit);
+                            //Debugging::get()->drawCurve(fit.curve, color, typeNames[type]);
+                        }
 
-                            fit.curve = endNoCurv;
-                            fit.startCurvSign = fit.endCurvSign = (endNoCurv->startCurvature() > 0. ? 1 : -1);
+                        fit.curve = endNoCurv;
+                        fit.startCurvSign = fit.endCurvSign = (endNoCurv->startCurvature() > 0. ? 1 : -1);
 
-                            if(_adjust)
-                                adjustPrimitive(fit, fitter);
+                        if(_adjust)
+                            adjustPrimitive(fit, fitter, stats);
 
-                            fit.error = errorComputer->computeErrorForCost(fit.curve, i, fit.endIdx);
+                        fit.error = errorComputer->computeErrorForCostBounded(fit.curve, i, fit.endIdx, errorThreshold * errorThreshold);
 
-                            if(fit.error < errorThreshold * errorThreshold)
-                            {
-                                out.primitives.push_back(fit);
-                                //Debugging::get()->drawCurve(fit.curve, color, typeNames[type]);
-                            }
+                        if(fit.error < errorThreshold * errorThreshold)
+                        {
+                            out.push_back(fit);
+                            //Debugging::get()->drawCurve(fit.curve, color, typeNames[type]);
                         }
                     }
-                    if(fitSoFar > 1 && corners[circ.index()])
-                        break;
                 }
+                if(fitSoFar > 1 && corners[circ.index()])
+                    break;
             }
         }
     }
 
-    void adjustPrimitive(const FitPrimitive &primitive, const Fitter &fitter)
+    void adjustPrimitive(const FitPrimitive &primitive, const Fitter &fitter, FitStats &stats) const
     {
         ErrorComputerConstPtr errorComputer = fitter.output<ERROR_COMPUTER>()->errorComputer;
         bool inflectionAccounting = fitter.params().get(Parameters::INFLECTION_COST) > 0.;
@@ -308,10 +429,15 @@ protected:
 
         //solve
         OneCurveProblem problem(primitive, errorComputer);
-        LSSolver solver(&problem, constraints);
+        LSSolverFixed<6> solver(&problem, constraints);
         solver.setDefaultDamping(fitter.params().get(Parameters::CURVE_ADJUST_DAMPING));
+        solver.setTrustRegion(fitter.params().get(Parameters::TRUST_REGION_SOLVER) != 0.);
+        solver.setGeodesicAcceleration(fitter.params().get(Parameters::GEODESIC_ACCELERATION) != 0.);
         solver.setMaxIter(1);
         problem.setParams(solver.solve(problem.params()));
+        stats.solverIterations += solver.iterations();
+        stats.solverHalvings += solver.halvings();
+        stats.solverRejections += solver.rejections();
     }
 };
 
@@ -54,6 +54,45 @@ void PrimitiveSequence::eval(double s, Vec *pos, Vec *der, Vec *der2) const
     _primitives[idx]->eval(cParam, pos, der, der2);
 }
 
+void PrimitiveSequence::samplePositions(double from, double step, int count, Vec *out) const
+{
+    if(step <= 0.)
+    {
+        Curve::samplePositions(from, step, count, out);
+        return;
+    }
+
+    //Walk along the primitives, handing each one the run of samples that falls on it
+    const int numPrimitives = (int)_primitives.size();
+    int idx = 0;
+    int i = 0;
+    while(i < count)
+    {
+        double s = from + i * step;
+        if(_primitives.circular())
+        {
+            s = fmod(s, _lengths.back());
+            if(s < 0.)
+                s += _lengths.back();
+        }
+        if(s < _lengths[idx] || s > _lengths[idx + 1]) //not where the walk expected (e.g., at the start)
+            idx = max(0, paramToIdx(s));
+
+        //the last primitive of an open sequence takes all the remaining samples
+        bool last = (idx == numPrimitives - 1);
+        int runCount = count - i;
+        if(!last || _primitives.circular())
+            runCount = min(runCount, (int)ceil((_lengths[idx + 1] - s) / step));
+        if(runCount > 0)
+        {
+            _primitives[idx]->samplePositions(s - _lengths[idx], step, runCount, out + i);
+            i += runCount;
+        }
+
+        idx = last ? 0 : idx + 1;
+    }
+}
+
 double PrimitiveSequence::project(const Vector2d &point) const
 {
     double bestS = 0.;
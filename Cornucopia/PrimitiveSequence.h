@@ -42,6 +42,7 @@ public:
     void eval(double s, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const;
 
     double project(const Vec &point) const;
+    void samplePositions(double from, double step, int count, Vec *out) const;
 
     //utility functions
     int paramToIdx(double param, double *outParam = NULL) const;
@@ -0,0 +1,116 @@
+/*--
+    ProjectionKernels.cpp  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ProjectionKernels.h"
+#include "defs.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+NAMESPACE_Cornu
+
+static bool cpuSupportsAVX2()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+bool projectionKernelsUseAVX2()
+{
+    static const bool useAVX2 = avx2KernelsCompiled() && cpuSupportsAVX2();
+    return useAVX2;
+}
+
+void projectLineMany(const LineKernelData &line, int n, const double *x, const double *y, double *outS)
+{
+    if(projectionKernelsUseAVX2())
+    {
+        projectLineManyAVX2(line, n, x, y, outS);
+        return;
+    }
+
+    for(int i = 0; i < n; ++i)
+        outS[i] = min(line.length, max(0., line.dx * (x[i] - line.x) + line.dy * (y[i] - line.y)));
+}
+
+void distanceSqLineMany(const LineKernelData &line, int n, const double *x, const double *y, double *outDistSq)
+{
+    if(projectionKernelsUseAVX2())
+    {
+        distanceSqLineManyAVX2(line, n, x, y, outDistSq);
+        return;
+    }
+
+    for(int i = 0; i < n; ++i)
+    {
+        double s = min(line.length, max(0., line.dx * (x[i] - line.x) + line.dy * (y[i] - line.y)));
+        outDistSq[i] = SQR(line.x + s * line.dx - x[i]) + SQR(line.y + s * line.dy - y[i]);
+    }
+}
+
+void projectArcMany(const ArcKernelData &arc, int n, const double *x, const double *y, double *outS)
+{
+    if(projectionKernelsUseAVX2())
+    {
+        projectArcManyAVX2(arc, n, x, y, outS);
+        return;
+    }
+
+    for(int i = 0; i < n; ++i)
+    {
+        double vx = x[i] - arc.cx, vy = y[i] - arc.cy;
+        double along = arc.midX * vx + arc.midY * vy;
+        double across = arc.turn * (arc.midX * vy - arc.midY * vx);
+
+        double s;
+        if(along >= sqrt(SQR(vx) + SQR(vy)) * arc.cosHalfAngle) //within the angle of the arc
+            s = (atan2(across, along) + arc.halfAngle) * arc.radius;
+        else
+            s = (across < 0.) ? 0. : arc.length;
+        outS[i] = min(arc.length, max(0., s));
+    }
+}
+
+void distanceSqArcMany(const ArcKernelData &arc, int n, const double *x, const double *y, double *outDistSq)
+{
+    if(projectionKernelsUseAVX2())
+    {
+        distanceSqArcManyAVX2(arc, n, x, y, outDistSq);
+        return;
+    }
+
+    for(int i = 0; i < n; ++i)
+    {
+        double vx = x[i] - arc.cx, vy = y[i] - arc.cy;
+        double dist = sqrt(SQR(vx) + SQR(vy));
+        if(arc.midX * vx + arc.midY * vy >= dist * arc.cosHalfAngle) //within the angle of the arc
+            outDistSq[i] = SQR(dist - arc.radius);
+        else
+            outDistSq[i] = min(SQR(x[i] - arc.startX) + SQR(y[i] - arc.startY), SQR(x[i] - arc.endX) + SQR(y[i] - arc.endY));
+    }
+}
+
+END_NAMESPACE_Cornu
@@ -0,0 +1,73 @@
+/*--
+    ProjectionKernels.h  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_PROJECTIONKERNELS_H_INCLUDED
+#define CORNUCOPIA_PROJECTIONKERNELS_H_INCLUDED
+
+//Batch projection onto lines and arcs, behind Line::projectMany, Arc::distanceSqMany, etc.  The points are given as
+//separate arrays of x and y coordinates.  There are AVX2 versions of the kernels, in a file compiled for AVX2, which
+//are used when the processor supports them.  That file includes this one, so this header must not include anything
+//with inline functions (which could end up compiled for AVX2 and called on any processor): no defs.h and no Eigen.
+
+namespace Cornu
+{
+
+struct LineKernelData
+{
+    double x, y; //start
+    double dx, dy; //unit direction
+    double length;
+};
+
+//an arc that is not flat
+struct ArcKernelData
+{
+    double cx, cy; //center
+    double radius; //positive
+    double midX, midY; //unit vector from the center to the middle of the arc
+    double halfAngle; //half the angle the arc spans (positive)
+    double cosHalfAngle;
+    double turn; //1 if the arc turns counterclockwise, -1 if clockwise
+    double startX, startY, endX, endY;
+    double length;
+};
+
+//These write the arclength parameter of the closest point on the curve for each of the n points
+void projectLineMany(const LineKernelData &line, int n, const double *x, const double *y, double *outS);
+void projectArcMany(const ArcKernelData &arc, int n, const double *x, const double *y, double *outS);
+
+//These write the squared distance to the curve of each of the n points.  For arcs, this does not need an angle:
+//points within the angle the arc spans are as far from it as from the circle, the others are closest to an end.
+void distanceSqLineMany(const LineKernelData &line, int n, const double *x, const double *y, double *outDistSq);
+void distanceSqArcMany(const ArcKernelData &arc, int n, const double *x, const double *y, double *outDistSq);
+
+bool projectionKernelsUseAVX2(); //whether the processor supports the AVX2 kernels and they were compiled in
+
+//The AVX2 kernels, called by the ones above.  They only do something if ProjectionKernelsAVX2.cpp is compiled for AVX2
+//and FMA, which avx2KernelsCompiled() tells.
+bool avx2KernelsCompiled();
+void projectLineManyAVX2(const LineKernelData &line, int n, const double *x, const double *y, double *outS);
+void projectArcManyAVX2(const ArcKernelData &arc, int n, const double *x, const double *y, double *outS);
+void distanceSqLineManyAVX2(const LineKernelData &line, int n, const double *x, const double *y, double *outDistSq);
+void distanceSqArcManyAVX2(const ArcKernelData &arc, int n, const double *x, const double *y, double *outDistSq);
+
+}
+
+#endif //CORNUCOPIA_PROJECTIONKERNELS_H_INCLUDED
@@ -0,0 +1,201 @@
+/*--
+    ProjectionKernelsAVX2.cpp  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//This file is compiled with AVX2 and FMA enabled (see CMakeLists.txt), and its functions are only called on
+//processors that have them.  Any inline function it instantiated from a header could be merged by the linker with
+//the copies in other files and then run on any processor, so it includes nothing but the intrinsics and the
+//(inline-free) kernel declarations.
+
+#include "ProjectionKernels.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+#include <immintrin.h>
+
+namespace Cornu
+{
+
+bool avx2KernelsCompiled() { return true; }
+
+//Loads the four points from i on, repeating the last point past n
+static inline void load4(int i, int n, const double *x, const double *y, __m256d &outX, __m256d &outY)
+{
+    if(i + 4 <= n)
+    {
+        outX = _mm256_loadu_pd(x + i);
+        outY = _mm256_loadu_pd(y + i);
+        return;
+    }
+
+    double bufX[4], bufY[4];
+    for(int j = 0; j < 4; ++j)
+    {
+        int idx = (i + j < n) ? i + j : n - 1;
+        bufX[j] = x[idx];
+        bufY[j] = y[idx];
+    }
+    outX = _mm256_loadu_pd(bufX);
+    outY = _mm256_loadu_pd(bufY);
+}
+
+//Stores the values for the points from i on that are before n
+static inline void store4(int i, int n, __m256d values, double *out)
+{
+    if(i + 4 <= n)
+    {
+        _mm256_storeu_pd(out + i, values);
+        return;
+    }
+
+    double buf[4];
+    _mm256_storeu_pd(buf, values);
+    for(int j = 0; i + j < n; ++j)
+        out[i + j] = buf[j];
+}
+
+static inline __m256d clamp4(__m256d v, __m256d length)
+{
+    return _mm256_min_pd(length, _mm256_max_pd(_mm256_setzero_pd(), v));
+}
+
+//atan2 to about double precision: the ratio of the smaller to the larger coordinate is reduced to below tan(pi/8)
+//and goes into the rational approximation of atan from the Cephes library.
+static inline __m256d atan2v(__m256d y, __m256d x)
+{
+    const __m256d signMask = _mm256_set1_pd(-0.);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.);
+
+    __m256d ax = _mm256_andnot_pd(signMask, x), ay = _mm256_andnot_pd(signMask, y);
+    __m256d num = _mm256_min_pd(ax, ay), den = _mm256_max_pd(ax, ay);
+    den = _mm256_blendv_pd(den, one, _mm256_cmp_pd(den, zero, _CMP_EQ_OQ)); //atan2(0, 0) = 0
+    __m256d a = _mm256_div_pd(num, den);
+
+    __m256d reduce = _mm256_cmp_pd(a, _mm256_set1_pd(0.41421356237309504880), _CMP_GT_OQ);
+    __m256d t = _mm256_blendv_pd(a, _mm256_div_pd(_mm256_sub_pd(a, one), _mm256_add_pd(a, one)), reduce);
+    __m256d z = _mm256_mul_pd(t, t);
+
+    __m256d p = _mm256_set1_pd(-8.750608600031904122785E-1);
+    p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(-1.615753718733365076637E1));
+    p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(-7.500855792314704667340E1));
+    p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(-1.228866684490136173410E2));
+    p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(-6.485021904942025371773E1));
+    __m256d q = _mm256_add_pd(z, _mm256_set1_pd(2.485846490142306297962E1));
+    q = _mm256_fmadd_pd(q, z, _mm256_set1_pd(1.650270098316988542046E2));
+    q = _mm256_fmadd_pd(q, z, _mm256_set1_pd(4.328810604912902668951E2));
+    q = _mm256_fmadd_pd(q, z, _mm256_set1_pd(4.853903996359136964868E2));
+    q = _mm256_fmadd_pd(q, z, _mm256_set1_pd(1.945506571482613964425E2));
+
+    __m256d r = _mm256_fmadd_pd(_mm256_mul_pd(t, z), _mm256_div_pd(p, q), t);
+    r = _mm256_add_pd(r, _mm256_and_pd(reduce, _mm256_set1_pd(0.78539816339744830962)));
+
+    r = _mm256_blendv_pd(r, _mm256_sub_pd(_mm256_set1_pd(1.5707963267948966192), r), _mm256_cmp_pd(ay, ax, _CMP_GT_OQ));
+    r = _mm256_blendv_pd(r, _mm256_sub_pd(_mm256_set1_pd(3.1415926535897932385), r), _mm256_cmp_pd(x, zero, _CMP_LT_OQ));
+    return _mm256_or_pd(r, _mm256_and_pd(signMask, y)); //r is not negative, so this copies the sign of y
+}
+
+static inline __m256d lineProject4(const LineKernelData &line, __m256d px, __m256d py)
+{
+    __m256d dx = _mm256_sub_pd(px, _mm256_set1_pd(line.x)), dy = _mm256_sub_pd(py, _mm256_set1_pd(line.y));
+    __m256d s = _mm256_fmadd_pd(_mm256_set1_pd(line.dx), dx, _mm256_mul_pd(_mm256_set1_pd(line.dy), dy));
+    return clamp4(s, _mm256_set1_pd(line.length));
+}
+
+void projectLineManyAVX2(const LineKernelData &line, int n, const double *x, const double *y, double *outS)
+{
+    for(int i = 0; i < n; i += 4)
+    {
+        __m256d px, py;
+        load4(i, n, x, y, px, py);
+        store4(i, n, lineProject4(line, px, py), outS);
+    }
+}
+
+void distanceSqLineManyAVX2(const LineKernelData &line, int n, const double *x, const double *y, double *outDistSq)
+{
+    for(int i = 0; i < n; i += 4)
+    {
+        __m256d px, py;
+        load4(i, n, x, y, px, py);
+        __m256d s = lineProject4(line, px, py);
+        __m256d ex = _mm256_sub_pd(_mm256_fmadd_pd(s, _mm256_set1_pd(line.dx), _mm256_set1_pd(line.x)), px);
+        __m256d ey = _mm256_sub_pd(_mm256_fmadd_pd(s, _mm256_set1_pd(line.dy), _mm256_set1_pd(line.y)), py);
+        store4(i, n, _mm256_fmadd_pd(ex, ex, _mm256_mul_pd(ey, ey)), outDistSq);
+    }
+}
+
+void projectArcManyAVX2(const ArcKernelData &arc, int n, const double *x, const double *y, double *outS)
+{
+    const __m256d midX = _mm256_set1_pd(arc.midX), midY = _mm256_set1_pd(arc.midY);
+    const __m256d length = _mm256_set1_pd(arc.length);
+
+    for(int i = 0; i < n; i += 4)
+    {
+        __m256d px, py;
+        load4(i, n, x, y, px, py);
+        __m256d vx = _mm256_sub_pd(px, _mm256_set1_pd(arc.cx)), vy = _mm256_sub_pd(py, _mm256_set1_pd(arc.cy));
+        __m256d along = _mm256_fmadd_pd(midX, vx, _mm256_mul_pd(midY, vy));
+        __m256d across = _mm256_mul_pd(_mm256_set1_pd(arc.turn), _mm256_fmsub_pd(midX, vy, _mm256_mul_pd(midY, vx)));
+        __m256d dist = _mm256_sqrt_pd(_mm256_fmadd_pd(vx, vx, _mm256_mul_pd(vy, vy)));
+        __m256d inside = _mm256_cmp_pd(along, _mm256_mul_pd(dist, _mm256_set1_pd(arc.cosHalfAngle)), _CMP_GE_OQ);
+
+        __m256d sInside = _mm256_mul_pd(_mm256_add_pd(atan2v(across, along), _mm256_set1_pd(arc.halfAngle)), _mm256_set1_pd(arc.radius));
+        __m256d sOutside = _mm256_and_pd(_mm256_cmp_pd(across, _mm256_setzero_pd(), _CMP_GE_OQ), length);
+        store4(i, n, clamp4(_mm256_blendv_pd(sOutside, sInside, inside), length), outS);
+    }
+}
+
+void distanceSqArcManyAVX2(const ArcKernelData &arc, int n, const double *x, const double *y, double *outDistSq)
+{
+    const __m256d midX = _mm256_set1_pd(arc.midX), midY = _mm256_set1_pd(arc.midY);
+
+    for(int i = 0; i < n; i += 4)
+    {
+        __m256d px, py;
+        load4(i, n, x, y, px, py);
+        __m256d vx = _mm256_sub_pd(px, _mm256_set1_pd(arc.cx)), vy = _mm256_sub_pd(py, _mm256_set1_pd(arc.cy));
+        __m256d along = _mm256_fmadd_pd(midX, vx, _mm256_mul_pd(midY, vy));
+        __m256d dist = _mm256_sqrt_pd(_mm256_fmadd_pd(vx, vx, _mm256_mul_pd(vy, vy)));
+        __m256d inside = _mm256_cmp_pd(along, _mm256_mul_pd(dist, _mm256_set1_pd(arc.cosHalfAngle)), _CMP_GE_OQ);
+
+        __m256d toCircle = _mm256_sub_pd(dist, _mm256_set1_pd(arc.radius));
+        __m256d sx = _mm256_sub_pd(px, _mm256_set1_pd(arc.startX)), sy = _mm256_sub_pd(py, _mm256_set1_pd(arc.startY));
+        __m256d ex = _mm256_sub_pd(px, _mm256_set1_pd(arc.endX)), ey = _mm256_sub_pd(py, _mm256_set1_pd(arc.endY));
+        __m256d toEnds = _mm256_min_pd(_mm256_fmadd_pd(sx, sx, _mm256_mul_pd(sy, sy)), _mm256_fmadd_pd(ex, ex, _mm256_mul_pd(ey, ey)));
+        store4(i, n, _mm256_blendv_pd(toEnds, _mm256_mul_pd(toCircle, toCircle), inside), outDistSq);
+    }
+}
+
+}
+
+#else //not compiled for AVX2--the kernels are never called
+
+namespace Cornu
+{
+
+bool avx2KernelsCompiled() { return false; }
+void projectLineManyAVX2(const LineKernelData &, int, const double *, const double *, double *) {}
+void projectArcManyAVX2(const ArcKernelData &, int, const double *, const double *, double *) {}
+void distanceSqLineManyAVX2(const LineKernelData &, int, const double *, const double *, double *) {}
+void distanceSqArcManyAVX2(const ArcKernelData &, int, const double *, const double *, double *) {}
+
+}
+
+#endif
@@ -344,6 +344,18 @@ class DefaultResampler : public BaseResampler
 public:
     string name() const { return "Default"; }
 
+    //override
+    vector<ParameterDependency> dependencies() const
+    {
+        vector<ParameterDependency> out;
+        out.push_back(ParameterDependency(Parameters::DENSE_SAMPLING_STEP));
+        out.push_back(ParameterDependency(Parameters::CURVATURE_ESTIMATE_REGION));
+        out.push_back(ParameterDependency(Parameters::MAX_SAMPLING_INTERVAL));
+        out.push_back(ParameterDependency(Parameters::POINTS_PER_CIRCLE));
+        out.push_back(ParameterDependency(Parameters::MAX_SAMPLE_RATE_SLOPE));
+        return out;
+    }
+
 protected:
     vector<double> _resample(const Fitter &fitter, PolylineConstPtr poly, bool denseNearStart = false, bool denseNearEnd = false)
     {
@@ -461,6 +473,14 @@ class LengthResampler : public BaseResampler
 public:
     string name() const { return "Length"; }
 
+    //override
+    vector<ParameterDependency> dependencies() const
+    {
+        vector<ParameterDependency> out;
+        out.push_back(ParameterDependency(Parameters::MAX_SAMPLING_INTERVAL));
+        return out;
+    }
+
 protected:
     vector<double> _resample(const Fitter &fitter, PolylineConstPtr poly, bool denseNearStart = false, bool denseNearEnd = false)
     {
@@ -20,29 +20,19 @@
 
 #include "SimpleAPI.h"
 #include "Cornucopia.h"
+#include "Threading.h"
 
 using namespace std;
 using namespace Eigen;
 NAMESPACE_Cornu
 
-vector<BasicPrimitive> fit(const vector<Point> &points, const Parameters &parameters, bool *outClosed)
+static vector<BasicPrimitive> _toBasicPrimitives(PrimitiveSequenceConstPtr output, bool *outClosed)
 {
-    Fitter fitter;
-    fitter.setParams(parameters);
-
-    VectorC<Vector2d> pts((int)points.size(), NOT_CIRCULAR);
-    for(int i = 0; i < pts.size(); ++i)
-        pts[i] = Vector2d(points[i].x, points[i].y);
-
-    //pass it to the fitter and process it
-    fitter.setOriginalSketch(new Cornu::Polyline(pts));
-    fitter.run();
-
-    //process the output -- count the number of primitives of each type
-    PrimitiveSequenceConstPtr output = fitter.finalOutput();
-
     if(outClosed)
-        (*outClosed) = output->isClosed();
+        (*outClosed) = output && output->isClosed();
+
+    if(!output)
+        return vector<BasicPrimitive>();
 
     vector<BasicPrimitive> out(output->primitives().size());
 
@@ -62,6 +52,115 @@ vector<BasicPrimitive> fit(const vector<Point> &points, const Parameters &parame
     return out;
 }
 
+static PolylinePtr _toPolyline(const vector<Point> &points)
+{
+    VectorC<Vector2d> pts((int)points.size(), NOT_CIRCULAR);
+    for(int i = 0; i < pts.size(); ++i)
+        pts[i] = Vector2d(points[i].x, points[i].y);
+    return new Polyline(pts);
+}
+
+static vector<BasicPrimitive> _fit(const vector<Point> &points, const Parameters &parameters, Debugging *debugging, bool *outClosed)
+{
+    Fitter fitter;
+    fitter.setParams(parameters);
+    fitter.setDebugging(debugging);
+
+    //pass it to the fitter and process it
+    fitter.setOriginalSketch(_toPolyline(points));
+    fitter.run();
+
+    return _toBasicPrimitives(fitter.finalOutput(), outClosed);
+}
+
+vector<BasicPrimitive> fit(const vector<Point> &points, const Parameters &parameters, bool *outClosed)
+{
+    return _fit(points, parameters, NULL, outClosed);
+}
+
+//fits one stroke of a batch per task
+class _BatchFitTask : public ParallelTask
+{
+public:
+    _BatchFitTask(const vector<vector<Point> > &strokes, const Parameters &parameters)
+        : _strokes(strokes), _parameters(parameters), output(strokes.size()), closed(strokes.size(), 0) {}
+
+    //override
+    void run(int index)
+    {
+        bool isClosed;
+        output[index] = _fit(_strokes[index], _parameters, Debugging::silent(), &isClosed);
+        closed[index] = isClosed; //not a vector<bool> because neighboring elements are written concurrently
+    }
+
+private:
+    _BatchFitTask &operator=(const _BatchFitTask &);
+
+    const vector<vector<Point> > &_strokes;
+    const Parameters &_parameters;
+
+public:
+    vector<vector<BasicPrimitive> > output;
+    vector<char> closed;
+};
+
+vector<vector<BasicPrimitive> > fitBatch(const vector<vector<Point> > &strokes, const Parameters &parameters, int numThreads, vector<bool> *outClosed)
+{
+    _BatchFitTask task(strokes, parameters);
+    parallelFor(task, (int)strokes.size(), numThreads);
+
+    if(outClosed)
+        outClosed->assign(task.closed.begin(), task.closed.end());
+
+    return task.output;
+}
+
+//runs a set of forked fitters, one per task
+class _ForkFitTask : public ParallelTask
+{
+public:
+    _ForkFitTask(vector<Fitter> &fitters) : _fitters(fitters) {}
+
+    //override
+    void run(int index) { _fitters[index].run(); }
+
+private:
+    _ForkFitTask &operator=(const _ForkFitTask &);
+
+    vector<Fitter> &_fitters;
+};
+
+vector<vector<BasicPrimitive> > fitMultiple(const vector<Point> &points, const vector<Parameters> &parameterSets, int numThreads)
+{
+    vector<vector<BasicPrimitive> > out(parameterSets.size());
+    if(parameterSets.empty())
+        return out;
+
+    Fitter base;
+    base.setDebugging(Debugging::silent());
+    base.setParams(parameterSets[0]);
+    base.setOriginalSketch(_toPolyline(points));
+
+    //run the stages that come out the same for all parameter sets once
+    AlgorithmStage firstDifferent = NUM_ALGORITHM_STAGES;
+    for(int i = 1; i < (int)parameterSets.size(); ++i)
+        firstDifferent = min(firstDifferent, Fitter::firstAffectedStage(parameterSets[0], parameterSets[i]));
+    if(firstDifferent > SCALE_DETECTION)
+        base.runUpTo(AlgorithmStage(firstDifferent - 1));
+
+    vector<Fitter> fitters;
+    for(int i = 0; i < (int)parameterSets.size(); ++i)
+        fitters.push_back(base.fork(parameterSets[i]));
+
+    _ForkFitTask task(fitters);
+    parallelFor(task, (int)fitters.size(), numThreads);
+
+    for(int i = 0; i < (int)fitters.size(); ++i)
+        out[i] = _toBasicPrimitives(fitters[i].finalOutput(), NULL);
+
+    return out;
+}
+
 //converts a BasicPrimitive to a CurvePrimitive
 CurvePrimitivePtr _toCurvePrimitive(const BasicPrimitive &primitive)
 {
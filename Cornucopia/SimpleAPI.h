@@ -63,6 +63,18 @@ struct BasicPrimitive
 //and returns a vector of primitives and (optionally) whether the curve is closed
 std::vector<BasicPrimitive> fit(const std::vector<Point> &points, const Parameters &parameters, bool *outClosed = NULL);
 
+//Fits many strokes at once, spreading them over up to numThreads threads (zero means one per processor).
+//Results (and optionally closedness) are returned in the order of the input strokes.  No debugging
+//output is produced for the batch.  A stroke that cannot be fit gives an empty vector.
+std::vector<std::vector<BasicPrimitive> > fitBatch(const std::vector<std::vector<Point> > &strokes, const Parameters &parameters,
+                                                   int numThreads = 0, std::vector<bool> *outClosed = NULL);
+
+//Fits the same points with each of several parameter sets (e.g., the presets).  The stages whose output is the
+//same for all of them run only once, and the rest run on up to numThreads threads (zero means one per processor).
+//Results are returned in the order of the parameter sets.  No debugging output is produced.
+std::vector<std::vector<BasicPrimitive> > fitMultiple(const std::vector<Point> &points, const std::vector<Parameters> &parameterSets,
+                                                      int numThreads = 0);
+
 struct BasicBezier
 {
     Point controlPoint[4];
@@ -27,24 +27,32 @@ using namespace Eigen;
 NAMESPACE_Cornu
 
 LSSolver::LSSolver(LSProblem *problem, const vector<LSBoxConstraint> &constraints)
-: _problem(problem), _constraints(constraints), _damping(1.), _maxIter(100),
-  _increaseDampingAfter(0), _dampingIncreaseFactor(1.)
+: _problem(problem), _constraints(constraints), _damping(1.), _maxIter(100), _increaseDampingAfter(0),
+  _dampingIncreaseFactor(1.), _trustRegion(false), _geodesicAcceleration(false), _iterations(0), _halvings(0), _rejections(0)
 {
 };
 
 VectorXd LSSolver::solve(const VectorXd &guess)
 {
+    if(_trustRegion)
+        return _solveTrustRegion(guess);
+
     VectorXd best;
     double bestError = 1e100;
     VectorXd x = guess;
     LSEvalData *evalData = _problem->createEvalData();
 
     set<LSBoxConstraint> activeSet = _clamp(x);
+    best = x; //in case the error is never finite
 
     VectorXd delta;
     int iter;
+    _iterations = _halvings = _rejections = 0;
     for(iter = 0; iter < _maxIter; ++iter)
     {
+        if(_problem->cancelled())
+            break;
+        ++_iterations;
         if(iter > _increaseDampingAfter)
             _damping *= _dampingIncreaseFactor;
         _problem->eval(x, evalData);
@@ -80,6 +88,7 @@ VectorXd LSSolver::solve(const VectorXd &guess)
             delta *= 0.5;
             x -= delta;
             ++halvings;
+            ++_halvings;
         }
         if(halvings > 0) //halve again -- won't hurt and may actually help
         {
@@ -100,6 +109,87 @@ VectorXd LSSolver::solve(const VectorXd &guess)
     return best;
 }
 
+//Levenberg-Marquardt: a step is only taken if its gain ratio is positive, otherwise it is retried with more
+//damping.  The eval data at the trial point becomes the eval data for the next iteration, so each iteration
+//evaluates the problem once (twice with geodesic acceleration).
+VectorXd LSSolver::_solveTrustRegion(const VectorXd &guess)
+{
+    VectorXd x = guess;
+    LSEvalData *evalData = _problem->createEvalData();
+    LSEvalData *trialData = _problem->createEvalData();
+    LSTrustRegion trustRegion(_damping);
+
+    set<LSBoxConstraint> activeSet = _clamp(x);
+    _problem->eval(x, evalData);
+    double error = evalData->error();
+
+    VectorXd delta, acceleration;
+    int iter;
+    _iterations = _halvings = _rejections = 0;
+    for(iter = 0; iter < _maxIter; ++iter)
+    {
+        if(_problem->cancelled())
+            break;
+        ++_iterations;
+        if(error < 1e-10)
+            break;
+
+        set<LSBoxConstraint> prevActiveSet = activeSet;
+        evalData->solveForDelta(trustRegion.damping(), delta, activeSet);
+
+        if(delta.squaredNorm() < 1e-14)
+            break;
+
+        if(_geodesicAcceleration)
+        {
+            double h = LSTrustRegion::accelerationStep();
+            _problem->eval(x + h * delta, trialData);
+            //variables whose constraints were just released are not corrected: their step is only known to be feasible without it
+            if(evalData->solveForAcceleration(trustRegion.damping(), delta, h, trialData, prevActiveSet, acceleration))
+            {
+                if(!LSTrustRegion::acceptAcceleration(delta.norm(), acceleration.norm()))
+                {
+                    trustRegion.reject();
+                    ++_rejections;
+                    activeSet = prevActiveSet;
+                    continue;
+                }
+                delta += 0.5 * acceleration;
+            }
+        }
+
+        int newConstraint = _project(x, delta, prevActiveSet);
+
+        if(newConstraint != -1)
+            activeSet.insert(_constraints[newConstraint]);
+
+        double modelError = evalData->modelError(delta);
+        _problem->eval(x + delta, trialData);
+        double newError = trialData->error();
+        double gain = LSTrustRegion::gain(error, modelError, newError);
+        if(gain > 0.)
+        {
+            x += delta;
+            error = newError;
+            swap(evalData, trialData);
+            trustRegion.accept(gain);
+        }
+        else
+        {
+            trustRegion.reject();
+            ++_rejections;
+            activeSet = prevActiveSet;
+        }
+    }
+
+    if(iter > 5)
+        Debugging::get()->printf("After %d iterations, error = %lf", iter, sqrt(error));
+
+    delete evalData;
+    delete trialData;
+    return x;
+}
+
 set<LSBoxConstraint> LSSolver::_clamp(VectorXd &x)
 {
     set<LSBoxConstraint> out;
@@ -258,6 +348,117 @@ void LSDenseEvalData::solveForDelta(double damping, VectorXd &out, set<LSBoxCons
     }
 }
 
+bool LSDenseEvalData::solveForAcceleration(double damping, const VectorXd &delta, double h, const LSEvalData *displaced,
+                                           const set<LSBoxConstraint> &constraints, VectorXd &out) const
+{
+    const LSDenseEvalData *displacedData = static_cast<const LSDenseEvalData *>(displaced);
+
+    //same system as for delta, with the residual replaced by its second directional derivative along delta
+    LSDenseEvalData secondDer;
+    secondDer._err = (2. / h) * ((displacedData->_err - _err) / h - _errDer * delta);
+    secondDer._errDer = _errDer;
+
+    set<LSBoxConstraint> activeSet = constraints;
+    secondDer.solveForDelta(damping, out, activeSet);
+    return true;
+}
+
+BlockTridiagonalSolver::BlockTridiagonalSolver(const vector<MatrixXd> &diagonal, const vector<MatrixXd> &offDiagonal, bool cyclic)
+: _dense(false)
+{
+    int n = (int)diagonal.size();
+    _offsets.resize(n + 1, 0);
+    for(int i = 0; i < n; ++i)
+        _offsets[i + 1] = _offsets[i] + (int)diagonal[i].rows();
+
+    if(cyclic && n <= 2) //the corners are not separate from the tridiagonal part
+    {
+        _dense = true;
+        int size = _offsets.back();
+        MatrixXd full = MatrixXd::Zero(size, size);
+        for(int i = 0; i < n; ++i)
+        {
+            int next = (i + 1) % n;
+            full.block(_offsets[i], _offsets[i], diagonal[i].rows(), diagonal[i].cols()) += diagonal[i];
+            full.block(_offsets[i], _offsets[next], offDiagonal[i].rows(), offDiagonal[i].cols()) += offDiagonal[i];
+            full.block(_offsets[next], _offsets[i], offDiagonal[i].cols(), offDiagonal[i].rows()) += offDiagonal[i].transpose();
+        }
+        _denseChol.compute(full);
+        return;
+    }
+
+    if(!cyclic || offDiagonal.back().squaredNorm() == 0.)
+    {
+        _factorTridiagonal(diagonal, offDiagonal);
+        return;
+    }
+
+    //S = T - U U^T with U = [sI; 0; ...; 0; -E / s], where E is the corner block (n - 1, 0).  Then T = S + U U^T is
+    //positive definite and has no corners.  The scale s just keeps the two diagonal updates comparable.
+    const MatrixXd &corner = offDiagonal.back();
+    int first = (int)diagonal[0].rows(), last = (int)diagonal[n - 1].rows();
+    double scale = sqrt(corner.norm());
+
+    vector<MatrixXd> tDiagonal = diagonal;
+    tDiagonal[0].diagonal().array() += scale * scale;
+    tDiagonal[n - 1] += corner * corner.transpose() / (scale * scale);
+
+    _u = MatrixXd::Zero(_offsets.back(), first);
+    _u.topRows(first).diagonal().setConstant(scale);
+    _u.bottomRows(last) = -corner / scale;
+
+    _factorTridiagonal(tDiagonal, offDiagonal);
+    _tInvU = _u;
+    _solveTridiagonal(_tInvU);
+    _capacitanceChol.compute(MatrixXd::Identity(first, first) - _u.transpose() * _tInvU);
+}
+
+MatrixXd BlockTridiagonalSolver::solve(const MatrixXd &rhs) const
+{
+    if(_dense)
+        return _denseChol.solve(rhs);
+
+    MatrixXd out = rhs;
+    _solveTridiagonal(out);
+    if(_u.size() > 0)
+        out += _tInvU * _capacitanceChol.solve(_u.transpose() * out);
+    return out;
+}
+
+void BlockTridiagonalSolver::_factorTridiagonal(vector<MatrixXd> diagonal, const vector<MatrixXd> &offDiagonal)
+{
+    int n = (int)diagonal.size();
+    _chols.resize(n);
+    _w.resize(n - 1);
+    for(int i = 0; i < n; ++i)
+    {
+        if(i > 0)
+            diagonal[i] -= _w[i - 1].transpose() * _w[i - 1];
+        _chols[i].compute(diagonal[i]);
+        if(i + 1 < n)
+            _w[i] = _chols[i].matrixL().solve(offDiagonal[i]);
+    }
+}
+
+void BlockTridiagonalSolver::_solveTridiagonal(MatrixXd &inOut) const
+{
+    int n = (int)_chols.size();
+    for(int i = 0; i < n; ++i)
+    {
+        Block<MatrixXd> seg = inOut.middleRows(_offsets[i], _offsets[i + 1] - _offsets[i]);
+        if(i > 0)
+            seg.noalias() -= _w[i - 1].transpose() * inOut.middleRows(_offsets[i - 1], _offsets[i] - _offsets[i - 1]);
+        _chols[i].matrixL().solveInPlace(seg);
+    }
+    for(int i = n - 1; i >= 0; --i)
+    {
+        Block<MatrixXd> seg = inOut.middleRows(_offsets[i], _offsets[i + 1] - _offsets[i]);
+        if(i + 1 < n)
+            seg.noalias() -= _w[i] * inOut.middleRows(_offsets[i + 1], _offsets[i + 2] - _offsets[i + 1]);
+        _chols[i].matrixU().solveInPlace(seg);
+    }
+}
+
 
 END_NAMESPACE_Cornu
 
@@ -24,7 +24,10 @@
 #include "defs.h"
 #include <vector>
 #include <set>
+#include <algorithm>
+#include <cmath>
 #include <Eigen/Core>
+#include <Eigen/Cholesky>
 
 NAMESPACE_Cornu
 
@@ -46,6 +49,14 @@ public:
     virtual double error() const = 0;
     virtual void solveForDelta(double damping, Eigen::VectorXd &out, std::set<LSBoxConstraint> &constraints) = 0;
 
+    //for the trust region mode: the error of the linearized problem after the step delta, which solveForDelta
+    //has just computed.  By default, the step is assumed to solve the linearized problem exactly.
+    virtual double modelError(const Eigen::VectorXd &/*delta*/) const { return 0.; }
+    //for geodesic acceleration: the correction to delta from the second directional derivative of the residual
+    //along delta, given the data evaluated at x + h * delta.  Returns false if the problem doesn't support it.
+    virtual bool solveForAcceleration(double /*damping*/, const Eigen::VectorXd &/*delta*/, double /*h*/, const LSEvalData * /*displaced*/,
+                                      const std::set<LSBoxConstraint> &/*constraints*/, Eigen::VectorXd &/*out*/) const { return false; }
+
     //debugging functions for derivative check
     virtual Eigen::VectorXd errVec() const { return Eigen::VectorXd(); }
     virtual Eigen::MatrixXd errVecDer() const { return Eigen::MatrixXd(); }
@@ -59,6 +70,40 @@ public:
     virtual double error(const Eigen::VectorXd &x, LSEvalData *data) { eval(x, data); return data->error(); }
     virtual LSEvalData *createEvalData() = 0;
     virtual void eval(const Eigen::VectorXd &x, LSEvalData *data) = 0;
+
+    //checked before every iteration--if true, the solver stops and returns the best solution so far
+    virtual bool cancelled() const { return false; }
+};
+
+//Damping control for the trust region (Levenberg-Marquardt) mode of the solvers.  The gain ratio of a step is
+//its actual error reduction over the reduction the linearization predicted.  An accepted step shrinks the damping
+//by up to a factor of 3 depending on the gain, and consecutive rejected steps grow it geometrically (Nielsen).
+class LSTrustRegion
+{
+public:
+    LSTrustRegion(double damping) : _damping(damping), _growth(2.) {}
+
+    double damping() const { return _damping; }
+    void accept(double gain) { _damping = std::max(1e-9, _damping * std::max(1. / 3., 1. - std::pow(2. * gain - 1., 3))); _growth = 2.; }
+    void reject() { _damping = std::max(1e-9, _damping * _growth); _growth *= 2.; }
+
+    //the step is accepted if the gain is positive
+    static double gain(double error, double modelError, double newError)
+    {
+        if(!(error - modelError > 0.)) //the model predicts no reduction
+            return newError < error ? 0.5 : -1.;
+        return (error - newError) / (error - modelError);
+    }
+
+    //Geodesic acceleration (Transtrum and Sethna): the second directional derivative of the residual along the
+    //step is estimated by a finite difference with this fraction of the step, and the step is rejected if the
+    //correction is too large compared to it
+    static double accelerationStep() { return 0.1; }
+    static bool acceptAcceleration(double stepNorm, double accelerationNorm) { return 2. * accelerationNorm <= 0.75 * stepNorm; }
+
+private:
+    double _damping;
+    double _growth;
 };
 
 class LSSolver
@@ -71,10 +116,21 @@ public:
     void setMaxIter(int maxIter) { _maxIter = maxIter; }
     void setIncreaseDampingAfter(int iter) { _increaseDampingAfter = iter; }
     void setDampingIncreaseFactor(double factor) { _dampingIncreaseFactor = factor; }
+    //In the trust region mode, the default damping is only the initial value: it then follows the gain ratio of the
+    //steps, and steps that don't reduce the error are rejected instead of halved.  Only then can geodesic
+    //acceleration be used, if the eval data supports it.
+    void setTrustRegion(bool trustRegion) { _trustRegion = trustRegion; }
+    void setGeodesicAcceleration(bool accelerate) { _geodesicAcceleration = accelerate; }
+
+    //statistics of the last solve()
+    int iterations() const { return _iterations; }
+    int halvings() const { return _halvings; } //of the step in the line search
+    int rejections() const { return _rejections; } //of steps in the trust region mode
 
     bool verifyDerivatives(const Eigen::VectorXd &pt, double eps = 1e-6) const;
 
 private:
+    Eigen::VectorXd _solveTrustRegion(const Eigen::VectorXd &guess);
     int _project(const Eigen::VectorXd &from, Eigen::VectorXd &x, const std::set<LSBoxConstraint> &activeSet); //returns the index of the constraint
     std::set<LSBoxConstraint> _clamp(Eigen::VectorXd &x);
 
@@ -84,6 +140,11 @@ private:
     int _maxIter;
     int _increaseDampingAfter;
     double _dampingIncreaseFactor;
+    bool _trustRegion;
+    bool _geodesicAcceleration;
+    int _iterations;
+    int _halvings;
+    int _rejections;
 };
 
 class LSDenseEvalData : public LSEvalData
@@ -92,6 +153,9 @@ public:
     //overrides
     double error() const { return _err.squaredNorm(); }
     void solveForDelta(double damping, Eigen::VectorXd &out, std::set<LSBoxConstraint> &constraints);
+    double modelError(const Eigen::VectorXd &delta) const { return (_err + _errDer * delta).squaredNorm(); }
+    bool solveForAcceleration(double damping, const Eigen::VectorXd &delta, double h, const LSEvalData *displaced,
+                              const std::set<LSBoxConstraint> &constraints, Eigen::VectorXd &out) const;
     Eigen::VectorXd errVec() const { return _err; }
     Eigen::MatrixXd errVecDer() const { return _errDer; }
 
@@ -102,6 +166,406 @@ private:
     Eigen::MatrixXd _errDer;
 };
 
+//Solves S x = b for a symmetric positive definite S that is block tridiagonal or, if cyclic, block tridiagonal
+//plus the corner blocks coupling the last block with the first.  The tridiagonal part is factored by block
+//Cholesky; the corners are handled by the Sherman-Morrison-Woodbury formula with a low-rank update the size
+//of the first block.  Factoring and solving take time linear in the number of blocks.
+class BlockTridiagonalSolver
+{
+public:
+    //diagonal[i] is block (i, i) and offDiagonal[i] is block (i, i + 1), so offDiagonal has one fewer entry than
+    //diagonal unless the system is cyclic, in which case the last entry is block (n - 1, 0)
+    BlockTridiagonalSolver(const std::vector<Eigen::MatrixXd> &diagonal, const std::vector<Eigen::MatrixXd> &offDiagonal, bool cyclic);
+
+    Eigen::MatrixXd solve(const Eigen::MatrixXd &rhs) const;
+
+private:
+    void _factorTridiagonal(std::vector<Eigen::MatrixXd> diagonal, const std::vector<Eigen::MatrixXd> &offDiagonal);
+    void _solveTridiagonal(Eigen::MatrixXd &inOut) const;
+
+    std::vector<int> _offsets; //of the blocks, with the total size at the end
+    std::vector<Eigen::LLT<Eigen::MatrixXd> > _chols;
+    std::vector<Eigen::MatrixXd> _w; //_w[i] = L_i^-1 * offDiagonal[i]
+
+    bool _dense; //tiny cyclic systems are just factored directly
+    Eigen::LLT<Eigen::MatrixXd> _denseChol;
+
+    //for cyclic systems, S = T - U U^T, where T is the factored tridiagonal matrix
+    Eigen::MatrixXd _u;
+    Eigen::MatrixXd _tInvU;
+    Eigen::LLT<Eigen::MatrixXd> _capacitanceChol; //of I - U^T T^-1 U
+};
+
+
+//Problem interface for LSSolverFixed: at most N variables, any number of error terms
+template<int N>
+class LSProblemFixed
+{
+public:
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::AutoAlign, N, 1> Vec;
+
+    virtual ~LSProblemFixed() {}
+
+    virtual double error(const Vec &x) = 0;
+    virtual void eval(const Vec &x, Eigen::VectorXd &outErr, Eigen::MatrixXd &outErrDer) = 0;
+
+    //checked before every iteration--if true, the solver stops and returns the best solution so far
+    virtual bool cancelled() const { return false; }
+};
+
+//Same algorithm as LSSolver with a dense Jacobian, but for small problems (at most N <= 32 variables): the normal
+//equations are formed and factored in stack-allocated matrices, and the active set is a bitmask over the variables.
+//Nothing is allocated per step except what the problem's eval allocates for the error vector.
+template<int N>
+class LSSolverFixed
+{
+public:
+    typedef typename LSProblemFixed<N>::Vec Vec;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::AutoAlign, N, N> Mat;
+
+    LSSolverFixed(LSProblemFixed<N> *problem, const std::vector<LSBoxConstraint> &constraints)
+        : _problem(problem), _constraints(constraints), _damping(1.), _maxIter(100), _increaseDampingAfter(0),
+          _dampingIncreaseFactor(1.), _trustRegion(false), _geodesicAcceleration(false), _iterations(0), _halvings(0), _rejections(0) {}
+
+    Vec solve(const Vec &guess)
+    {
+        if(_trustRegion)
+            return _solveTrustRegion(guess);
+
+        double bestError = 1e100;
+        Vec x = guess;
+
+        unsigned int activeSet = _clamp(x);
+        Vec best = x; //in case the error is never finite
+
+        Vec delta;
+        int iter;
+        _iterations = _halvings = _rejections = 0;
+        for(iter = 0; iter < _maxIter; ++iter)
+        {
+            if(_problem->cancelled())
+                break;
+            ++_iterations;
+            if(iter > _increaseDampingAfter)
+                _damping *= _dampingIncreaseFactor;
+            _problem->eval(x, _err, _errDer);
+
+            double error = _err.squaredNorm();
+            if(error < bestError)
+            {
+                bestError = error;
+                best = x;
+
+                if(error < 1e-10)
+                    break;
+            }
+
+            unsigned int prevActiveSet = activeSet;
+            _solveForDelta(_damping, _err, delta, activeSet);
+
+            if(delta.squaredNorm() < 1e-14)
+                break;
+
+            int newConstraint = _project(x, delta, prevActiveSet);
+
+            if(newConstraint != -1)
+                _activate(activeSet, newConstraint);
+
+            x += delta;
+
+            int halvings = 0;
+            while(_problem->error(x) > error && delta.squaredNorm() > 1e-8)
+            {
+                delta *= 0.5;
+                x -= delta;
+                ++halvings;
+                ++_halvings;
+            }
+            if(halvings > 0) //halve again -- won't hurt and may actually help
+            {
+                delta *= 0.5;
+                x -= delta;
+            }
+        }
+
+        double error = _problem->error(x);
+        if(iter > 5)
+            Debugging::get()->printf("After %d iterations, error = %lf", iter, sqrt(error));
+        if(error < bestError)
+            best = x;
+
+        return best;
+    }
+
+    void setDefaultDamping(double damping) { _damping = damping; }
+    void setMaxIter(int maxIter) { _maxIter = maxIter; }
+    void setIncreaseDampingAfter(int iter) { _increaseDampingAfter = iter; }
+    void setDampingIncreaseFactor(double factor) { _dampingIncreaseFactor = factor; }
+    void setTrustRegion(bool trustRegion) { _trustRegion = trustRegion; } //see LSSolver
+    void setGeodesicAcceleration(bool accelerate) { _geodesicAcceleration = accelerate; }
+
+    //statistics of the last solve()
+    int iterations() const { return _iterations; }
+    int halvings() const { return _halvings; } //of the step in the line search
+    int rejections() const { return _rejections; } //of steps in the trust region mode
+
+    bool verifyDerivatives(const Vec &pt, double eps = 1e-6)
+    {
+        _problem->eval(pt, _err, _errDer);
+        Eigen::MatrixXd exactDer = _errDer;
+        Eigen::MatrixXd numDer = exactDer;
+        Eigen::VectorXd plus;
+
+        for(int i = 0; i < numDer.cols(); ++i)
+        {
+            Vec mod = pt;
+            mod[i] += eps;
+            _problem->eval(mod, _err, _errDer);
+            plus = _err;
+
+            mod[i] = pt[i] - eps;
+            _problem->eval(mod, _err, _errDer);
+
+            numDer.col(i) = (plus - _err) / (2 * eps);
+        }
+
+        Debugging::get()->printf("Derivative Error = %lf", (numDer - exactDer).norm());
+        return true;
+    }
+
+private:
+    //same as LSSolver::_solveTrustRegion
+    Vec _solveTrustRegion(const Vec &guess)
+    {
+        Vec x = guess;
+        LSTrustRegion trustRegion(_damping);
+
+        unsigned int activeSet = _clamp(x);
+        _problem->eval(x, _err, _errDer);
+        double error = _err.squaredNorm();
+
+        Vec delta, acceleration;
+        int iter;
+        _iterations = _halvings = _rejections = 0;
+        for(iter = 0; iter < _maxIter; ++iter)
+        {
+            if(_problem->cancelled())
+                break;
+            ++_iterations;
+            if(error < 1e-10)
+                break;
+
+            unsigned int prevActiveSet = activeSet;
+            _solveForDelta(trustRegion.damping(), _err, delta, activeSet);
+
+            if(delta.squaredNorm() < 1e-14)
+                break;
+
+            if(_geodesicAcceleration)
+            {
+                double h = LSTrustRegion::accelerationStep();
+                _problem->eval(x + h * delta, _trialErr, _trialErrDer);
+                Eigen::VectorXd secondDer = (2. / h) * ((_trialErr - _err) / h - _errDer * delta);
+                unsigned int accelerationActiveSet = prevActiveSet; //see LSSolver::_solveTrustRegion
+                _solveForDelta(trustRegion.damping(), secondDer, acceleration, accelerationActiveSet);
+                if(!LSTrustRegion::acceptAcceleration(delta.norm(), acceleration.norm()))
+                {
+                    trustRegion.reject();
+                    ++_rejections;
+                    activeSet = prevActiveSet;
+                    continue;
+                }
+                delta += 0.5 * acceleration;
+            }
+
+            int newConstraint = _project(x, delta, prevActiveSet);
+
+            if(newConstraint != -1)
+                _activate(activeSet, newConstraint);
+
+            double modelError = (_err + _errDer * delta).squaredNorm();
+            _problem->eval(x + delta, _trialErr, _trialErrDer);
+            double newError = _trialErr.squaredNorm();
+            double gain = LSTrustRegion::gain(error, modelError, newError);
+            if(gain > 0.)
+            {
+                x += delta;
+                error = newError;
+                _err.swap(_trialErr);
+                _errDer.swap(_trialErrDer);
+                trustRegion.accept(gain);
+            }
+            else
+            {
+                trustRegion.reject();
+                ++_rejections;
+                activeSet = prevActiveSet;
+            }
+        }
+
+        if(iter > 5)
+            Debugging::get()->printf("After %d iterations, error = %lf", iter, sqrt(error));
+
+        return x;
+    }
+
+    void _activate(unsigned int &activeSet, int constraintIdx)
+    {
+        int var = _constraints[constraintIdx].index;
+        if(activeSet & (1u << var))
+            return; //like inserting into a set ordered by variable, the first constraint on a variable wins
+        activeSet |= (1u << var);
+        _activeConstraint[var] = constraintIdx;
+    }
+
+    unsigned int _clamp(Vec &x)
+    {
+        unsigned int out = 0;
+        for(int i = 0; i < (int)_constraints.size(); ++i)
+        {
+            const LSBoxConstraint &c = _constraints[i];
+            if(c.sign == 0 || (x[c.index] - c.value) * c.sign < 0.)
+            {
+                x[c.index] = c.value;
+                _activate(out, i);
+            }
+        }
+        return out;
+    }
+
+    int _project(const Vec &from, Vec &delta, unsigned int activeSet) const //returns the index of the constraint
+    {
+        int closestConstraint = -1;
+        double minScale = 1.;
+
+        for(int i = 0; i < (int)_constraints.size(); ++i)
+        {
+            const LSBoxConstraint &c = _constraints[i];
+
+            if(c.sign == 0)
+                delta[c.index] = 0; //just in case
+
+            if(activeSet & (1u << c.index))
+                continue; //already constrained
+
+            double scale = (c.value - from[c.index]) / delta[c.index];
+
+            if((from[c.index] + delta[c.index] - c.value) * c.sign >= 0.)
+                continue;
+
+            if(scale < minScale)
+            {
+                minScale = scale;
+                closestConstraint = i;
+            }
+        }
+
+        if(closestConstraint >= 0)
+            delta *= minScale;
+
+        return closestConstraint;
+    }
+
+    //Instead of compacting the system to the free variables, the rows and columns of the constrained variables
+    //are replaced by identity rows and columns with a zero right hand side, which gives the same solution.
+    void _solveForDelta(double damping, const Eigen::VectorXd &err, Vec &out, unsigned int &activeSet)
+    {
+        int vars = (int)_errDer.cols();
+        Mat jtj(vars, vars); //only the lower triangle is filled in
+        Vec jte(vars);
+        for(int i = 0; i < vars; ++i)
+        {
+            for(int j = i; j < vars; ++j)
+                jtj(j, i) = _errDer.col(j).dot(_errDer.col(i));
+            jte[i] = _errDer.col(i).dot(err);
+        }
+
+        Mat lhs = jtj;
+        lhs.diagonal().array() += damping;
+        out = -jte;
+        for(int i = 0; i < vars; ++i)
+        {
+            if(!(activeSet & (1u << i)))
+                continue;
+            lhs.row(i).setZero();
+            lhs.col(i).setZero();
+            lhs(i, i) = 1.;
+            out[i] = 0.;
+        }
+
+        if(!_ldlSolve(lhs, out)) //not positive definite, e.g., no damping and a rank deficient Jacobian
+        {
+            lhs.template triangularView<Eigen::StrictlyUpper>() = lhs.transpose();
+            out = Eigen::LDLT<Mat>(lhs).solve(out);
+        }
+
+        if(activeSet == 0)
+            return;
+
+        //check which constraints we don't need
+        Vec gradient = jte;
+        gradient.noalias() += jtj.template selfadjointView<Eigen::Lower>() * out;
+        for(int i = 0; i < vars; ++i)
+        {
+            if((activeSet & (1u << i)) && gradient[i] * _constraints[_activeConstraint[i]].sign < 0) //if sign is zero, constraint will not get erased
+                activeSet &= ~(1u << i);
+        }
+    }
+
+    //Solves a x = rhs in place using the lower triangle of a, via an LDL^T factorization without pivoting, which
+    //is about twice as fast as Eigen's at these sizes.  On failure, returns false and leaves rhs untouched.
+    static bool _ldlSolve(const Mat &a, Vec &rhs)
+    {
+        int n = (int)a.rows();
+        Mat l(n, n); //unit lower triangle with D on the diagonal
+        for(int j = 0; j < n; ++j)
+        {
+            double d = a(j, j);
+            for(int k = 0; k < j; ++k)
+                d -= l(j, k) * l(j, k) * l(k, k);
+            if(!(d > 1e-12 * a(j, j))) //relative to the original diagonal, to catch pivots that are just roundoff
+                return false;
+            l(j, j) = d;
+            for(int i = j + 1; i < n; ++i)
+            {
+                double v = a(i, j);
+                for(int k = 0; k < j; ++k)
+                    v -= l(i, k) * l(j, k) * l(k, k);
+                l(i, j) = v / d;
+            }
+        }
+
+        for(int i = 0; i < n; ++i)
+            for(int k = 0; k < i; ++k)
+                rhs[i] -= l(i, k) * rhs[k];
+        for(int i = 0; i < n; ++i)
+            rhs[i] /= l(i, i);
+        for(int i = n - 1; i >= 0; --i)
+            for(int k = i + 1; k < n; ++k)
+                rhs[i] -= l(k, i) * rhs[k];
+        return true;
+    }
+
+    typedef char _AtMost32Variables[N <= 32 ? 1 : -1]; //the active set is a bitmask in an unsigned int
+
+    LSProblemFixed<N> *_problem;
+    std::vector<LSBoxConstraint> _constraints;
+    int _activeConstraint[N]; //for each variable in the active set, the index of its constraint
+    double _damping;
+    int _maxIter;
+    int _increaseDampingAfter;
+    double _dampingIncreaseFactor;
+    bool _trustRegion;
+    bool _geodesicAcceleration;
+    int _iterations;
+    int _halvings;
+    int _rejections;
+
+    Eigen::VectorXd _err; //reused across iterations
+    Eigen::MatrixXd _errDer;
+    Eigen::VectorXd _trialErr; //at the trial point in the trust region mode
+    Eigen::MatrixXd _trialErrDer;
+};
 
 END_NAMESPACE_Cornu
 
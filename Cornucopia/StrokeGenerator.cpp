@@ -0,0 +1,233 @@
+/*--
+    StrokeGenerator.cpp  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "StrokeGenerator.h"
+#include "Line.h"
+#include "Arc.h"
+#include "Clothoid.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace Eigen;
+NAMESPACE_Cornu
+
+StrokeGenerator::Options::Options()
+    : sampleSpacing(3.), spacingJitter(0.3), noise(0.3), quantization(0.),
+      minPrimitiveLength(40.), maxPrimitiveLength(200.), maxCurvature(0.03),
+      numCorners(0), hookProbability(0.3), hookLength(6.)
+{
+}
+
+double StrokeGenerator::uniform(double from, double to)
+{
+    //64-bit linear congruential generator (Knuth's MMIX constants); the top 53 bits make the double
+    _state = _state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return from + (to - from) * double(_state >> 11) * (1. / 9007199254740992.);
+}
+
+double StrokeGenerator::gaussian()
+{
+    //Box-Muller
+    double u1 = 1. - uniform(0., 1.); //in (0, 1]
+    double u2 = uniform(0., 1.);
+    return sqrt(-2. * log(u1)) * cos(TWOPI * u2);
+}
+
+PrimitiveSequencePtr StrokeGenerator::openCurve(double length)
+{
+    //the positions of the corners, spread out so that the pieces between them are long enough to fit on their own
+    vector<double> corners;
+    for(int i = 0; i < _options.numCorners; ++i)
+        corners.push_back((i + 1 + uniform(-0.25, 0.25)) * length / (_options.numCorners + 1));
+    int nextCorner = 0;
+
+    VectorC<CurvePrimitiveConstPtr> primitives(0, NOT_CIRCULAR);
+    Vector2d pos(uniform(0., 500.), uniform(0., 500.));
+    double angle = uniform(-PI, PI);
+    double curvature = 0.;
+    double lengthSoFar = 0.;
+
+    while(lengthSoFar < length)
+    {
+        double primLength = min(length - lengthSoFar, uniform(_options.minPrimitiveLength, _options.maxPrimitiveLength));
+        bool corner = nextCorner < (int)corners.size() && corners[nextCorner] < lengthSoFar + primLength;
+        if(corner)
+            primLength = corners[nextCorner++] - lengthSoFar;
+
+        if(primLength > 1e-8)
+        {
+            CurvePrimitivePtr prim;
+            double endCurvature = uniform(-_options.maxCurvature, _options.maxCurvature);
+            switch(int(uniform(0., 3.)))
+            {
+            case 0:
+                prim = new Line(pos, pos + primLength * Vector2d(cos(angle), sin(angle)));
+                break;
+            case 1:
+                //don't let a single arc turn more than halfway around
+                endCurvature = max(-PI / primLength, min(PI / primLength, endCurvature));
+                prim = new Arc(pos, angle, primLength, endCurvature);
+                break;
+            default:
+                prim = new Clothoid(pos, angle, primLength, curvature, endCurvature);
+                break;
+            }
+
+            primitives.push_back(prim);
+            pos = prim->endPos();
+            angle = prim->endAngle();
+            curvature = prim->endCurvature();
+            lengthSoFar += primLength;
+        }
+
+        if(corner)
+        {
+            angle += (uniform(0., 1.) < 0.5 ? -1. : 1.) * uniform(PI / 3., 2. * PI / 3.);
+            curvature = 0.;
+        }
+    }
+
+    return new PrimitiveSequence(primitives);
+}
+
+PrimitiveSequencePtr StrokeGenerator::closedCurve(double length)
+{
+    //A rounded polygon: sides joined by corners that ease into an arc and out of it with clothoids.  All corners
+    //are the same, so the curve closes up by symmetry.
+    int numSides = int(uniform(3., 7.));
+    double sideLength = length / numSides;
+    double lineLength = uniform(0.1, 0.6) * sideLength;
+    double transitionLength = uniform(0.2, 0.4) * (sideLength - lineLength);
+    double arcLength = sideLength - lineLength - 2. * transitionLength;
+    double curvature = (TWOPI / numSides) / (transitionLength + arcLength);
+    if(uniform(0., 1.) < 0.5)
+        curvature = -curvature;
+
+    VectorC<CurvePrimitiveConstPtr> primitives(0, CIRCULAR);
+    Vector2d pos(uniform(0., 500.), uniform(0., 500.));
+    double angle = uniform(-PI, PI);
+
+    for(int i = 0; i < numSides; ++i)
+    {
+        CurvePrimitivePtr prims[4];
+        prims[0] = new Line(pos, pos + lineLength * Vector2d(cos(angle), sin(angle)));
+        prims[1] = new Clothoid(prims[0]->endPos(), angle, transitionLength, 0., curvature);
+        prims[2] = new Arc(prims[1]->endPos(), prims[1]->endAngle(), arcLength, curvature);
+        prims[3] = new Clothoid(prims[2]->endPos(), prims[2]->endAngle(), transitionLength, curvature, 0.);
+
+        primitives.insert(primitives.end(), prims, prims + 4);
+        pos = prims[3]->endPos();
+        angle = prims[3]->endAngle();
+    }
+
+    return new PrimitiveSequence(primitives);
+}
+
+Vector2d StrokeGenerator::_perturb(const Vector2d &pt)
+{
+    Vector2d out = pt + _options.noise * Vector2d(gaussian(), gaussian());
+    if(_options.quantization > 0.)
+    {
+        for(int i = 0; i < 2; ++i)
+            out[i] = _options.quantization * floor(out[i] / _options.quantization + 0.5);
+    }
+    return out;
+}
+
+PolylinePtr StrokeGenerator::sample(const Curve &curve, double from, double to)
+{
+    VectorC<Vector2d> pts(0, NOT_CIRCULAR);
+
+    for(double s = from; s < to; s += _options.sampleSpacing * (1. + uniform(-_options.spacingJitter, _options.spacingJitter)))
+        pts.push_back(_perturb(curve.pos(s)));
+    pts.push_back(_perturb(curve.pos(to)));
+
+    return new Polyline(pts);
+}
+
+void StrokeGenerator::_addHook(const Curve &curve, bool atStart, VectorC<Vector2d> &pts)
+{
+    //a short tight arc that leaves the end of the stroke at a sharp angle--the pen sliding as it lands or lifts
+    double side = uniform(0., 1.) < 0.5 ? -1. : 1.;
+    double angle = atStart ? curve.startAngle() + PI : curve.endAngle();
+    angle += side * uniform(0.4, 1.2);
+    Arc hook(atStart ? curve.startPos() : curve.endPos(), angle, _options.hookLength, side * uniform(0.1, 0.3));
+
+    //hooks are drawn quickly, so they are sampled sparsely
+    VectorC<Vector2d> hookPts(0, NOT_CIRCULAR);
+    for(double s = 2. * _options.sampleSpacing; s <= _options.hookLength; s += 2. * _options.sampleSpacing)
+        hookPts.push_back(_perturb(hook.pos(s)));
+
+    if(atStart)
+        pts.insert(pts.begin(), hookPts.rbegin(), hookPts.rend());
+    else
+        pts.insert(pts.end(), hookPts.begin(), hookPts.end());
+}
+
+StrokeGenerator::Stroke StrokeGenerator::openStroke(int numPoints)
+{
+    Stroke out;
+    PrimitiveSequencePtr truth = openCurve(max(1, numPoints - 1) * _options.sampleSpacing);
+    VectorC<Vector2d> pts = sample(*truth, 0., truth->length())->pts();
+
+    if(uniform(0., 1.) < _options.hookProbability)
+        _addHook(*truth, true, pts);
+    if(uniform(0., 1.) < _options.hookProbability)
+        _addHook(*truth, false, pts);
+
+    out.truth = truth;
+    out.points = new Polyline(pts);
+    return out;
+}
+
+StrokeGenerator::Stroke StrokeGenerator::closedStroke(int numPoints)
+{
+    Stroke out;
+    PrimitiveSequencePtr truth = closedCurve(max(1, numPoints - 1) * _options.sampleSpacing);
+    out.truth = truth;
+    out.points = sample(*truth, 0., truth->length());
+    return out;
+}
+
+StrokeGenerator::OversketchPair StrokeGenerator::oversketchPair(int numPoints)
+{
+    OversketchPair out;
+    PrimitiveSequencePtr truth = openCurve(max(1, numPoints - 1) * _options.sampleSpacing);
+    double length = truth->length();
+    out.truth = truth;
+
+    //the base covers the first 65% of the truth and the oversketch the last half
+    out.base.truth = truth->trimmed(0., 0.65 * length);
+    VectorC<Vector2d> pts = sample(*truth, 0., 0.65 * length)->pts();
+    if(uniform(0., 1.) < _options.hookProbability)
+        _addHook(*out.base.truth, true, pts);
+    out.base.points = new Polyline(pts);
+
+    out.oversketch.truth = truth->trimmed(0.5 * length, length);
+    VectorC<Vector2d> ovPts = sample(*truth, 0.5 * length, length)->pts();
+    if(uniform(0., 1.) < _options.hookProbability)
+        _addHook(*out.oversketch.truth, false, ovPts);
+    out.oversketch.points = new Polyline(ovPts);
+
+    return out;
+}
+
+END_NAMESPACE_Cornu
@@ -0,0 +1,96 @@
+/*--
+    StrokeGenerator.h  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_STROKEGENERATOR_H_INCLUDED
+#define CORNUCOPIA_STROKEGENERATOR_H_INCLUDED
+
+#include "defs.h"
+#include "Polyline.h"
+#include "PrimitiveSequence.h"
+
+NAMESPACE_Cornu
+
+//Generates synthetic strokes for benchmarks and tests: a random ground-truth spline of lines, arcs and clothoids,
+//sampled the way a tablet would, with noise, uneven spacing and hooks at the ends.  The output depends only on the
+//seed and the options, so the same strokes can be regenerated on any platform.
+class StrokeGenerator
+{
+public:
+    struct Options
+    {
+        Options();
+
+        double sampleSpacing; //average distance between consecutive samples, in pixels
+        double spacingJitter; //the spacing varies uniformly by this fraction of itself, in [0, 1)
+        double noise; //standard deviation of the positional noise, in pixels
+        double quantization; //sample coordinates are rounded to multiples of this (0 means no rounding)
+        double minPrimitiveLength, maxPrimitiveLength;
+        double maxCurvature;
+        int numCorners; //sharp corners (G0 joints) in open curves
+        double hookProbability; //chance of a pen-down or a pen-up hook at each end of an open stroke
+        double hookLength;
+    };
+
+    struct Stroke
+    {
+        PrimitiveSequenceConstPtr truth;
+        PolylineConstPtr points;
+    };
+
+    //The oversketch stroke retraces the end of the base stroke and continues past it: fit base.points, pass the
+    //result as the oversketch base and fit oversketch.points to approximate truth.
+    struct OversketchPair
+    {
+        PrimitiveSequenceConstPtr truth;
+        Stroke base;
+        Stroke oversketch;
+    };
+
+    StrokeGenerator(unsigned int seed, const Options &options = Options()) : _state(seed), _options(options) {}
+
+    const Options &options() const { return _options; }
+    void setOptions(const Options &options) { _options = options; }
+
+    //strokes of about numPoints samples
+    Stroke openStroke(int numPoints);
+    Stroke closedStroke(int numPoints); //the stroke ends where it started, but the polyline isn't marked closed
+    OversketchPair oversketchPair(int numPoints); //numPoints is for the whole truth curve
+
+    //ground truth curves of the given length
+    PrimitiveSequencePtr openCurve(double length);
+    PrimitiveSequencePtr closedCurve(double length);
+
+    //samples the curve between the given parameters with noise and jitter, but no hooks
+    PolylinePtr sample(const Curve &curve, double from, double to);
+
+    double uniform(double from, double to);
+    double gaussian(); //standard normal
+
+private:
+    void _addHook(const Curve &curve, bool atStart, VectorC<Eigen::Vector2d> &pts);
+    Eigen::Vector2d _perturb(const Eigen::Vector2d &pt);
+
+    unsigned long long _state;
+    Options _options;
+};
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_STROKEGENERATOR_H_INCLUDED
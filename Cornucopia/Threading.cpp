@@ -0,0 +1,307 @@
+/*--
+    Threading.cpp  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Threading.h"
+
+#include <vector>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+NAMESPACE_Cornu
+
+#ifdef _WIN32
+
+Mutex::Mutex()
+{
+    CRITICAL_SECTION *cs = new CRITICAL_SECTION;
+    InitializeCriticalSection(cs);
+    _handle = cs;
+}
+
+Mutex::~Mutex()
+{
+    DeleteCriticalSection((CRITICAL_SECTION *)_handle);
+    delete (CRITICAL_SECTION *)_handle;
+}
+
+void Mutex::lock()
+{
+    EnterCriticalSection((CRITICAL_SECTION *)_handle);
+}
+
+void Mutex::unlock()
+{
+    LeaveCriticalSection((CRITICAL_SECTION *)_handle);
+}
+
+static BOOL CALLBACK onceCallback(PINIT_ONCE, PVOID func, PVOID *)
+{
+    ((void (*)())func)();
+    return TRUE;
+}
+
+void callOnce(OnceFlag &flag, void (*func)())
+{
+    InitOnceExecuteOnce((PINIT_ONCE)&flag, onceCallback, (PVOID)func, NULL);
+}
+
+//the hook's function is stored as the fiber-local value, so the callback knows what to call
+static VOID WINAPI threadExitCallback(PVOID func)
+{
+    if(func)
+        ((void (*)())func)();
+}
+
+ThreadExitHook::ThreadExitHook(void (*func)()) : _func(func)
+{
+    _key = FlsAlloc(threadExitCallback);
+}
+
+void ThreadExitHook::arm()
+{
+    FlsSetValue(_key, (PVOID)_func);
+}
+
+struct ThreadStarter
+{
+    static DWORD WINAPI start(LPVOID thread) { Thread::_threadFunc((Thread *)thread); return 0; }
+};
+
+void Thread::start()
+{
+    _handle = CreateThread(NULL, 0, ThreadStarter::start, this, 0, NULL);
+    if(!_handle) //could not create a thread--do the work on this one
+        run();
+}
+
+void Thread::join()
+{
+    if(!_handle)
+        return;
+    WaitForSingleObject((HANDLE)_handle, INFINITE);
+    CloseHandle((HANDLE)_handle);
+    _handle = NULL;
+}
+
+int Thread::numProcessors()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+}
+
+#else //pthreads
+
+Mutex::Mutex()
+{
+    pthread_mutex_t *mutex = new pthread_mutex_t;
+    pthread_mutex_init(mutex, NULL);
+    _handle = mutex;
+}
+
+Mutex::~Mutex()
+{
+    pthread_mutex_destroy((pthread_mutex_t *)_handle);
+    delete (pthread_mutex_t *)_handle;
+}
+
+void Mutex::lock()
+{
+    pthread_mutex_lock((pthread_mutex_t *)_handle);
+}
+
+void Mutex::unlock()
+{
+    pthread_mutex_unlock((pthread_mutex_t *)_handle);
+}
+
+void callOnce(OnceFlag &flag, void (*func)())
+{
+    pthread_once(&flag, func);
+}
+
+//the hook's function is stored as the thread-specific value, so the destructor knows what to call
+static void threadExitCallback(void *func)
+{
+    ((void (*)())func)();
+}
+
+ThreadExitHook::ThreadExitHook(void (*func)()) : _func(func)
+{
+    pthread_key_t key;
+    pthread_key_create(&key, threadExitCallback);
+    _key = (unsigned long)key;
+}
+
+void ThreadExitHook::arm()
+{
+    pthread_setspecific((pthread_key_t)_key, (void *)_func);
+}
+
+struct ThreadStarter
+{
+    static void *start(void *thread) { Thread::_threadFunc((Thread *)thread); return NULL; }
+};
+
+void Thread::start()
+{
+    pthread_t *thread = new pthread_t;
+    if(pthread_create(thread, NULL, ThreadStarter::start, this) != 0)
+    {
+        delete thread;
+        run(); //could not create a thread--do the work on this one
+        return;
+    }
+    _handle = thread;
+}
+
+void Thread::join()
+{
+    if(!_handle)
+        return;
+    pthread_join(*(pthread_t *)_handle, NULL);
+    delete (pthread_t *)_handle;
+    _handle = NULL;
+}
+
+int Thread::numProcessors()
+{
+    long num = sysconf(_SC_NPROCESSORS_ONLN);
+    return num > 0 ? (int)num : 1;
+}
+
+#endif
+
+//the indices not yet taken by a parallelFor worker
+struct _WorkRange
+{
+    _WorkRange() : begin(0), end(0) {}
+
+    //takes from the front (for the owner)
+    bool pop(int &index)
+    {
+        ScopedLock lock(mutex);
+        if(begin >= end)
+            return false;
+        index = begin++;
+        return true;
+    }
+
+    //takes from the back (for other workers)
+    bool steal(int &index)
+    {
+        ScopedLock lock(mutex);
+        if(begin >= end)
+            return false;
+        index = --end;
+        return true;
+    }
+
+    Mutex mutex;
+    volatile int begin;
+    volatile int end;
+};
+
+class _ParallelForWorker : public Thread
+{
+public:
+    _ParallelForWorker(ParallelTask &task, _WorkRange *ranges, int numRanges, int idx)
+        : _task(task), _ranges(ranges), _numRanges(numRanges), _idx(idx) {}
+
+    //override
+    void run()
+    {
+        int index;
+        for(;;)
+        {
+            if(_ranges[_idx].pop(index))
+            {
+                _task.run(index);
+                continue;
+            }
+
+            //steal from the worker with the most work left
+            int victim = -1, mostLeft = 0;
+            for(int i = 0; i < _numRanges; ++i)
+            {
+                int left = _ranges[i].end - _ranges[i].begin; //unsynchronized read is only a hint
+                if(left > mostLeft)
+                {
+                    mostLeft = left;
+                    victim = i;
+                }
+            }
+            if(victim < 0)
+                break;
+            if(_ranges[victim].steal(index))
+                _task.run(index);
+        }
+    }
+
+private:
+    _ParallelForWorker &operator=(const _ParallelForWorker &);
+
+    ParallelTask &_task;
+    _WorkRange *_ranges;
+    int _numRanges;
+    int _idx;
+};
+
+void parallelFor(ParallelTask &task, int numTasks, int numThreads)
+{
+    if(numThreads <= 0)
+        numThreads = Thread::numProcessors();
+    numThreads = std::min(numThreads, numTasks);
+    if(numThreads <= 1)
+    {
+        for(int i = 0; i < numTasks; ++i)
+            task.run(i);
+        return;
+    }
+
+    _WorkRange *ranges = new _WorkRange[numThreads];
+    for(int i = 0; i < numThreads; ++i)
+    {
+        ranges[i].begin = (int)((long long)numTasks * i / numThreads);
+        ranges[i].end = (int)((long long)numTasks * (i + 1) / numThreads);
+    }
+
+    std::vector<_ParallelForWorker *> workers;
+    for(int i = 0; i < numThreads; ++i)
+        workers.push_back(new _ParallelForWorker(task, ranges, numThreads, i));
+    for(int i = 1; i < numThreads; ++i)
+        workers[i]->start();
+    workers[0]->run(); //the calling thread is a worker too
+    for(int i = 0; i < numThreads; ++i)
+    {
+        workers[i]->join();
+        delete workers[i];
+    }
+    delete [] ranges;
+}
+
+END_NAMESPACE_Cornu
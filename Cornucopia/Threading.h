@@ -0,0 +1,134 @@
+/*--
+    Threading.h  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_THREADING_H_INCLUDED
+#define CORNUCOPIA_THREADING_H_INCLUDED
+
+#include "defs.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+NAMESPACE_Cornu
+
+//Minimal portable threading primitives (Win32 threads on Windows, pthreads elsewhere)
+
+class Mutex
+{
+public:
+    Mutex();
+    ~Mutex();
+
+    void lock();
+    void unlock();
+
+private:
+    Mutex(const Mutex &); //noncopyable
+    Mutex &operator=(const Mutex &);
+
+    void *_handle;
+};
+
+class ScopedLock
+{
+public:
+    ScopedLock(Mutex &mutex) : _mutex(mutex) { _mutex.lock(); }
+    ~ScopedLock() { _mutex.unlock(); }
+
+private:
+    ScopedLock &operator=(const ScopedLock &);
+
+    Mutex &_mutex;
+};
+
+//One-time initialization that is safe to trigger from several threads at once.
+//A OnceFlag must be statically initialized with CORNU_ONCE_INIT so that it is
+//valid before any constructors run.
+#ifdef _WIN32
+typedef void *OnceFlag; //has the same layout as INIT_ONCE
+#define CORNU_ONCE_INIT 0
+#else
+typedef pthread_once_t OnceFlag;
+#define CORNU_ONCE_INIT PTHREAD_ONCE_INIT
+#endif
+
+void callOnce(OnceFlag &flag, void (*func)());
+
+//Calls a function on every thread that has armed the hook when that thread exits, for handing back per-thread
+//caches.  The function may arm the hook again if it leaves something behind.  It is not called for the main
+//thread when the process exits.
+class ThreadExitHook
+{
+public:
+    ThreadExitHook(void (*func)());
+
+    void arm(); //for the calling thread
+
+private:
+    ThreadExitHook(const ThreadExitHook &); //noncopyable
+    ThreadExitHook &operator=(const ThreadExitHook &);
+
+    void (*_func)();
+    unsigned long _key;
+};
+
+//Subclass and override run().  The object must stay alive until join() returns.
+class Thread
+{
+public:
+    Thread() : _handle(NULL) {}
+    virtual ~Thread() {}
+
+    void start();
+    void join();
+
+    static int numProcessors();
+
+protected:
+    virtual void run() = 0;
+
+private:
+    Thread(const Thread &); //noncopyable
+    Thread &operator=(const Thread &);
+
+    static void _threadFunc(Thread *thread) { thread->run(); }
+    friend struct ThreadStarter;
+
+    void *_handle;
+};
+
+//A set of independent tasks indexed by an integer, for parallelFor
+class ParallelTask
+{
+public:
+    virtual ~ParallelTask() {}
+    virtual void run(int index) = 0; //called concurrently from several threads
+};
+
+//Runs task.run(i) for every i in [0, numTasks) using up to numThreads threads (including the calling one;
+//zero means one per processor) and returns when all are done.  Each thread starts with a contiguous block of
+//indices and, once it is out of work, steals indices from the end of another thread's block, so one slow
+//task does not hold up the ones queued behind it.
+void parallelFor(ParallelTask &task, int numTasks, int numThreads = 0);
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_THREADING_H_INCLUDED
@@ -38,6 +38,8 @@ NAMESPACE_Cornu
 class CombinedCurve
 {
 public:
+    typedef LSProblemFixed<10>::Vec ParamVec; //at most 6 + 2 * CLOTHOID parameters
+
     CombinedCurve(FitPrimitive p[2], int continuity, const Fitter &fitter)
         : _continuity(continuity), _evalCount(0)
     {
@@ -192,7 +194,7 @@ public:
         return 6 + _type[0] + _type[1] - _continuity; //6 is the DOFs of two lines connected at an endpoint
     }
 
-    void setParams(const VectorXd &params)
+    void setParams(const ParamVec &params)
     {
         CurvePrimitive::ParamVec v[2];
         v[0].resize(_c[0]->numParams());
@@ -220,7 +222,7 @@ public:
         _c[1]->setParams(v[1]);
     }
 
-    void getParams(VectorXd &params) const
+    void getParams(ParamVec &params) const
     {
         CurvePrimitive::ParamVec v[2];
         v[0] = _c[0]->params();
@@ -377,31 +379,27 @@ private:
     double _origEndCurvature[2];
 };
 
-class TwoCurveProblem : public LSProblem
+class TwoCurveProblem : public LSProblemFixed<10>
 {
 public:
-    TwoCurveProblem(CombinedCurve &curves) : _curves(curves) {}
+    TwoCurveProblem(CombinedCurve &curves, const Fitter &fitter) : _curves(curves), _fitter(fitter) {}
 
     //overrides
-    double error(const Eigen::VectorXd &x, LSEvalData *)
+    double error(const Vec &x)
     {
         _curves.setParams(x);
         return _curves.computeError();
     }
-    LSEvalData *createEvalData()
-    {
-        return new LSDenseEvalData();
-    }
-    void eval(const Eigen::VectorXd &x, LSEvalData *data)
+    void eval(const Vec &x, VectorXd &outErr, MatrixXd &outErrDer)
     {
-        LSDenseEvalData *twoCurveData = static_cast<LSDenseEvalData *>(data);
         _curves.setParams(x);
-        _curves.computeErrorVector(twoCurveData->errVectorRef(), twoCurveData->errDerRef());
-        //cout << "Err = " << twoCurveData->error() << endl;
+        _curves.computeErrorVector(outErr, outErrDer);
     }
+    bool cancelled() const { return _fitter.cancelled(); }
 
 private:
     CombinedCurve &_curves;
+    const Fitter &_fitter;
 };
 
 Combination twoCurveCombine(int p1, int p2, int continuity, const Fitter &fitter)
@@ -430,10 +428,8 @@ Combination twoCurveCombine(int p1, int p2, int continuity, const Fitter &fitter
 
     CombinedCurve combined(primArray, continuity, fitter);
 
-    VectorXd x;
+    CombinedCurve::ParamVec x;
     combined.getParams(x);
-    VectorXd errVec;
-    MatrixXd errVecDer;
 
     vector<LSBoxConstraint> constraints;
 
@@ -497,13 +493,18 @@ Combination twoCurveCombine(int p1, int p2, int continuity, const Fitter &fitter
         }
     }
 
-    TwoCurveProblem problem(combined);
-    LSSolver solver(&problem, constraints);
+    TwoCurveProblem problem(combined, fitter);
+    LSSolverFixed<10> solver(&problem, constraints);
     solver.setDefaultDamping(fitter.params().get(Parameters::CURVE_ADJUST_DAMPING));
+    solver.setTrustRegion(fitter.params().get(Parameters::TRUST_REGION_SOLVER) != 0.);
+    solver.setGeodesicAcceleration(fitter.params().get(Parameters::GEODESIC_ACCELERATION) != 0.);
     solver.setMaxIter(5);
     //solver.verifyDerivatives(x);
     x = solver.solve(x);
     combined.setParams(x);
+    fitter.runningStats().solverIterations += solver.iterations();
+    fitter.runningStats().solverHalvings += solver.halvings();
+    fitter.runningStats().solverRejections += solver.rejections();
 
 #if 0
     if(origDrawn)
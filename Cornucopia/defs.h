@@ -34,6 +34,37 @@
 namespace std {}
 namespace Eigen {}
 
+//Thread-local storage and atomic integer operations--these are needed so that
+//several fitters can run on different threads at the same time.
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CORNU_THREAD_LOCAL __declspec(thread)
+#else
+#define CORNU_THREAD_LOCAL __thread
+#endif
+
+namespace Cornu
+{
+#ifdef _MSC_VER
+    inline int atomicIncrement(volatile int *val) { return (int)_InterlockedIncrement((volatile long *)val); }
+    inline int atomicDecrement(volatile int *val) { return (int)_InterlockedDecrement((volatile long *)val); }
+    inline bool atomicCompareExchange(volatile int *val, int expected, int desired)
+    { return _InterlockedCompareExchange((volatile long *)val, desired, expected) == expected; }
+    //volatile accesses have acquire and release semantics with MSVC
+    inline int atomicLoadAcquire(const volatile int *val) { int out = *val; _ReadWriteBarrier(); return out; }
+    inline void atomicStoreRelease(volatile int *val, int newVal) { _ReadWriteBarrier(); *val = newVal; }
+    inline void memoryBarrier() { _ReadWriteBarrier(); _mm_mfence(); _ReadWriteBarrier(); }
+#else
+    inline int atomicIncrement(volatile int *val) { return __sync_add_and_fetch(val, 1); }
+    inline int atomicDecrement(volatile int *val) { return __sync_sub_and_fetch(val, 1); }
+    inline bool atomicCompareExchange(volatile int *val, int expected, int desired)
+    { return __sync_bool_compare_and_swap(val, expected, desired); }
+    inline int atomicLoadAcquire(const volatile int *val) { return __atomic_load_n(val, __ATOMIC_ACQUIRE); }
+    inline void atomicStoreRelease(volatile int *val, int newVal) { __atomic_store_n(val, newVal, __ATOMIC_RELEASE); }
+    inline void memoryBarrier() { __sync_synchronize(); }
+#endif
+}
+
 #include "Debugging.h"
 
 namespace Cornu
@@ -31,7 +31,7 @@ template<typename T> class smart_ptr;
 class smart_base
 {
 private:
-    mutable int _refCount;
+    mutable volatile int _refCount; //modified atomically so that objects can be shared between threads
 
 public:
     smart_base() : _refCount(0) {}
@@ -46,12 +46,12 @@ protected:
 
     virtual void addRef() const
     {
-        ++_refCount;
+        atomicIncrement(&_refCount);
     }
     virtual void releaseRef() const
     {
         bool free = false;
-        free = (--_refCount <= 0);
+        free = (atomicDecrement(&_refCount) <= 0);
         if (free)
             const_cast<smart_base *>(this)->freeRef();
     }
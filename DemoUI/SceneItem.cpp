@@ -23,6 +23,7 @@
 #include "Polyline.h"
 
 #include <QPainter>
+#include <Eigen/StdVector>
 
 using namespace std;
 using namespace Eigen;
@@ -82,13 +83,16 @@ CurveSceneItem::CurveSceneItem(Cornu::CurveConstPtr curve, QString group, QPen p
     }
     else
     {
-        for(double s = 0; s < curve->length(); s += 2.) //skip pixels
+        const double step = 2.; //skip pixels
+        vector<Vector2d, Eigen::aligned_allocator<Vector2d> > samples(curve->numUniformSamples(step));
+        curve->sampleUniform(step, &(samples[0]));
+        for(int i = 0; i < (int)samples.size(); ++i)
+            _curveTess.push_back(QPointF(samples[i][0], samples[i][1]));
+        if((samples.back() - curve->endPos()).norm() > 1e-6)
         {
-             pt = curve->pos(s);
+            pt = curve->endPos();
             _curveTess.push_back(QPointF(pt[0], pt[1]));
         }
-        pt = curve->endPos();
-        _curveTess.push_back(QPointF(pt[0], pt[1]));
     }
 
     _rect = _curveTess.boundingRect();
@@ -49,6 +49,15 @@ public:
         arc = new Arc(Vector2d(-1., 3.), -0.5, 39, -0.1);
         testProject(arc);
 
+        arc = new Arc(Vector2d(-1., 3.), 2., 12, 1e-7); //flat
+        testProject(arc);
+
+        for(int i = 0; i < 20; ++i)
+        {
+            arc = new Arc(Vector2d(drand(-5, 5), drand(-5, 5)), drand(-PI, PI), drand(0.1, 30.), drand(-0.2, 0.2));
+            testProject(arc);
+        }
+
         for(int i = 0; i < 2; ++i)
         {
             VectorC<Vector2d> pts(5, i == 1 ? CIRCULAR : NOT_CIRCULAR);
@@ -67,6 +76,15 @@ public:
         {
             ClothoidPtr clothoid = new Clothoid(Vector2d(0.5, 1), 0.3, drand(0.01, 3.), drand(-5.1, 5.1), drand(-5.1, 5.1));
             testProject(clothoid);
+            testOrderedProject(clothoid);
+        }
+
+        for(int i = 0; i < 20; ++i) //tightly wound spirals, far along the canonical clothoid
+        {
+            double startCurvature = drand(5., 200.);
+            ClothoidPtr clothoid = new Clothoid(Vector2d(0.5, 1), 0.3, drand(0.5, 2.), startCurvature, startCurvature + drand(20., 100.));
+            testProject(clothoid);
+            testOrderedProject(clothoid);
         }
 
         Debugging::get()->printf("Projection max dot product = %.10lf", maxDot);
@@ -102,6 +120,25 @@ public:
                 CORNU_ASSERT_LT_MSG(projDist, (pt - newPt).norm() + tol * (pt - newPt).squaredNorm(), "Projection should be closest point");
             }
         }
+
+        //the batch versions should agree with the one-point ones (up to ties between two closest points)
+        const int numPts = 37; //not a multiple of the vector width
+        double x[numPts], y[numPts], batchS[numPts], batchDistSq[numPts];
+        for(int i = 0; i < numPts; ++i)
+        {
+            x[i] = drand(-10, 10);
+            y[i] = drand(-10, 10);
+        }
+        curve->projectMany(numPts, x, y, batchS);
+        curve->distanceSqMany(numPts, x, y, batchDistSq);
+        for(int i = 0; i < numPts; ++i)
+        {
+            Vector2d pt(x[i], y[i]);
+            double distSq = curve->distanceSqTo(pt);
+            CORNU_ASSERT_LT_MSG(fabs(batchDistSq[i] - distSq), 1e-9 * (1. + distSq), "Batch distance differs");
+            CORNU_ASSERT_LT_MSG(fabs((curve->pos(batchS[i]) - pt).squaredNorm() - distSq), 1e-9 * (1. + distSq), "Batch projection differs");
+        }
+
         if(false) for(int i = 0; i < 105000; ++i)
         {
             Vector2d pt = Vector2d(drand(-10, 10), drand(-10, 10));
@@ -109,6 +146,27 @@ public:
         }
     }
 
+    //samples of a stroke along the curve, which the batch projection warm-starts from one to the next
+    void testOrderedProject(CurvePtr curve)
+    {
+        const int numPts = 50;
+        double x[numPts], y[numPts], batchS[numPts];
+        for(int i = 0; i < numPts; ++i)
+        {
+            Vector2d pt = curve->pos(curve->length() * i / (numPts - 1.)) + Vector2d(drand(-0.05, 0.05), drand(-0.05, 0.05));
+            x[i] = pt[0];
+            y[i] = pt[1];
+        }
+        curve->projectMany(numPts, x, y, batchS);
+        for(int i = 0; i < numPts; ++i)
+        {
+            Vector2d pt(x[i], y[i]);
+            double dist = (curve->pos(curve->project(pt)) - pt).norm();
+            double batchDist = (curve->pos(batchS[i]) - pt).norm();
+            CORNU_ASSERT_LT_MSG(fabs(batchDist - dist), 1e-6, "Ordered batch projection differs");
+        }
+    }
+
     double maxDot;
 };
 
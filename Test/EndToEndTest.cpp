@@ -33,7 +33,13 @@ public:
     void run()
     {
         simpleAPITest();
+        batchAPITest();
         fullAPITest();
+        parameterChangeTest();
+        multiplePresetsTest();
+        cancellationTest();
+        steppingTest();
+        statsTest();
     }
 
     void simpleAPITest()
@@ -62,6 +68,56 @@ public:
         Cornu::Debugging::get()->printf("Conversion to Bezier results in %d segments\n", bezier.size());
     }
 
+    void batchAPITest()
+    {
+        using Cornu::Debugging; //for CORNU_ASSERT
+
+        Cornu::Parameters params; //default values
+        std::vector<std::vector<Cornu::Point> > strokes(40);
+
+        for(int i = 0; i < (int)strokes.size(); ++i)
+        {
+            int num = (i % 7 == 0) ? 400 : 20 + i; //a few long strokes among short ones
+            for(int j = 0; j < num; ++j)
+            {
+                double t = double(j) / num;
+                strokes[i].push_back(Cornu::Point(100. * i + 200. * t, 100. + 50. * sin(6. * t * (1 + i % 3))));
+            }
+        }
+
+        std::vector<bool> closed;
+        std::vector<std::vector<Cornu::BasicPrimitive> > result = Cornu::fitBatch(strokes, params, 4, &closed);
+
+        CORNU_ASSERT(result.size() == strokes.size() && closed.size() == strokes.size());
+        for(int i = 0; i < (int)strokes.size(); ++i)
+        {
+            CORNU_ASSERT_MSG(!result[i].empty(), "Batch stroke " << i << " was not fit");
+
+            //the same stroke fit on its own
+            Cornu::VectorC<Eigen::Vector2d> pts((int)strokes[i].size(), Cornu::NOT_CIRCULAR);
+            for(int j = 0; j < pts.size(); ++j)
+                pts[j] = Eigen::Vector2d(strokes[i][j].x, strokes[i][j].y);
+            Cornu::Fitter fitter;
+            fitter.setDebugging(Debugging::silent());
+            fitter.setParams(params);
+            fitter.setOriginalSketch(new Cornu::Polyline(pts));
+            fitter.run();
+            Cornu::PrimitiveSequenceConstPtr serial = fitter.finalOutput();
+
+            CORNU_ASSERT_MSG(serial && serial->primitives().size() == (int)result[i].size() && serial->isClosed() == closed[i],
+                             "Batch result " << i << " differs");
+            for(int j = 0; j < (int)result[i].size(); ++j)
+            {
+                Cornu::CurvePrimitiveConstPtr prim = serial->primitives()[j];
+                CORNU_ASSERT_MSG(prim->getType() == (int)result[i][j].type && prim->length() == result[i][j].length &&
+                                 prim->startPos()[0] == result[i][j].start.x && prim->startPos()[1] == result[i][j].start.y,
+                                 "Batch result " << i << " differs at primitive " << j);
+            }
+        }
+
+        Cornu::Debugging::get()->printf("Batch API Finished, %d strokes\n", (int)result.size());
+    }
+
     void fullAPITest()
     {
         //initialize the fitter
@@ -114,6 +170,210 @@ public:
 
         //output is destroyed with the destruction of the smart pointer and the fitter
     }
+
+    //changing parameters should rerun only the stages that depend on them and give the same result as a fresh fit
+    void parameterChangeTest()
+    {
+        using Cornu::Debugging; //for CORNU_ASSERT
+
+        Cornu::VectorC<Eigen::Vector2d> pts(60, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i) //a parabola followed by a corner and a straight segment
+            pts[i] = (i < 40) ? Eigen::Vector2d(4. * i, 0.05 * i * i) : Eigen::Vector2d(160., 80. - 4. * (i - 40));
+
+        Cornu::Fitter fitter;
+        fitter.setDebugging(Debugging::silent());
+        fitter.setOriginalSketch(new Cornu::Polyline(pts));
+        fitter.run();
+
+        Cornu::AlgorithmOutputBaseConstPtr primitives = fitter.output<Cornu::PRIMITIVE_FITTING>();
+
+        Cornu::Parameters params = fitter.params();
+        params.set(Cornu::Parameters::G2_COST, 5.);
+        params.set(Cornu::Parameters::LINE_COST, 3.);
+        fitter.setParams(params);
+
+        CORNU_ASSERT_MSG(fitter.output<Cornu::PRIMITIVE_FITTING>() == primitives, "Primitive fitting should not be invalidated");
+        CORNU_ASSERT_MSG(!fitter.output<Cornu::GRAPH_CONSTRUCTION>(), "Graph construction should be invalidated");
+
+        fitter.run();
+
+        Cornu::Fitter fresh;
+        fresh.setDebugging(Debugging::silent());
+        fresh.setParams(params);
+        fresh.setOriginalSketch(new Cornu::Polyline(pts));
+        fresh.run();
+
+        Cornu::PrimitiveSequenceConstPtr a = fitter.finalOutput(), b = fresh.finalOutput();
+        CORNU_ASSERT(a && b && a->primitives().size() == b->primitives().size());
+        for(int i = 0; i < a->primitives().size(); ++i)
+            CORNU_ASSERT_MSG(a->primitives()[i]->params() == b->primitives()[i]->params(), "Primitive " << i << " differs from a fresh fit");
+
+        //making lines unavailable changes which primitives get fit
+        params.set(Cornu::Parameters::LINE_COST, Cornu::Parameters::infinity);
+        fitter.setParams(params);
+        CORNU_ASSERT_MSG(!fitter.output<Cornu::PRIMITIVE_FITTING>(), "Primitive fitting should be invalidated");
+        CORNU_ASSERT_MSG(fitter.output<Cornu::RESAMPLING>(), "Resampling should not be invalidated");
+    }
+
+    //fitting with all the presets at once should give the same results as fitting with each separately
+    void multiplePresetsTest()
+    {
+        using Cornu::Debugging; //for CORNU_ASSERT
+
+        std::vector<std::vector<Cornu::Point> > strokes(1);
+        for(int i = 0; i < 60; ++i)
+            strokes[0].push_back(i < 40 ? Cornu::Point(4. * i, 0.05 * i * i) : Cornu::Point(160., 80. - 4. * (i - 40)));
+
+        std::vector<Cornu::Parameters> presets = Cornu::Parameters::presets();
+        std::vector<std::vector<Cornu::BasicPrimitive> > result = Cornu::fitMultiple(strokes[0], presets, 3);
+
+        CORNU_ASSERT(result.size() == presets.size());
+        for(int i = 0; i < (int)presets.size(); ++i)
+        {
+            std::vector<Cornu::BasicPrimitive> separate = Cornu::fitBatch(strokes, presets[i], 1)[0];
+
+            CORNU_ASSERT_MSG(separate.size() == result[i].size(), "Preset " << presets[i].name() << " differs");
+            for(int j = 0; j < (int)separate.size(); ++j)
+            {
+                CORNU_ASSERT_MSG(separate[j].type == result[i][j].type && separate[j].length == result[i][j].length &&
+                                 separate[j].startCurvature == result[i][j].startCurvature,
+                                 "Preset " << presets[i].name() << " differs at primitive " << j);
+            }
+        }
+    }
+
+    //cancels the fit halfway through primitive fitting
+    class CancellingMonitor : public Cornu::FitMonitor
+    {
+    public:
+        CancellingMonitor() : lastStage(-1), lastFraction(0.), monotonic(true) {}
+
+        //override
+        void progress(Cornu::AlgorithmStage stage, double fraction)
+        {
+            if(stage < lastStage || (stage == lastStage && fraction < lastFraction))
+                monotonic = false;
+            lastStage = stage;
+            lastFraction = fraction;
+            if(stage == Cornu::PRIMITIVE_FITTING && fraction >= 0.5)
+                cancel();
+        }
+
+        int lastStage;
+        double lastFraction;
+        bool monotonic;
+    };
+
+    //a cancelled fit should stop in the middle of a stage and continue from it when run again
+    void cancellationTest()
+    {
+        using Cornu::Debugging; //for CORNU_ASSERT
+
+        Cornu::VectorC<Eigen::Vector2d> pts(60, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i)
+            pts[i] = (i < 40) ? Eigen::Vector2d(4. * i, 0.05 * i * i) : Eigen::Vector2d(160., 80. - 4. * (i - 40));
+
+        Cornu::Fitter fitter;
+        fitter.setDebugging(Debugging::silent());
+        fitter.setOriginalSketch(new Cornu::Polyline(pts));
+
+        CancellingMonitor monitor;
+        CORNU_ASSERT_MSG(!fitter.run(&monitor), "Fit should have been cancelled");
+        CORNU_ASSERT_MSG(monitor.monotonic, "Progress should not go backwards");
+        CORNU_ASSERT_MSG(monitor.lastStage == Cornu::PRIMITIVE_FITTING && monitor.lastFraction < 1., "Fit should stop during primitive fitting");
+        CORNU_ASSERT_MSG(fitter.output<Cornu::ERROR_COMPUTER>(), "Completed stages should be kept");
+        CORNU_ASSERT_MSG(!fitter.output<Cornu::PRIMITIVE_FITTING>() && !fitter.finalOutput(), "The cancelled stage should be discarded");
+
+        CORNU_ASSERT(fitter.run());
+
+        Cornu::Fitter fresh;
+        fresh.setDebugging(Debugging::silent());
+        fresh.setOriginalSketch(new Cornu::Polyline(pts));
+        fresh.run();
+
+        Cornu::PrimitiveSequenceConstPtr a = fitter.finalOutput(), b = fresh.finalOutput();
+        CORNU_ASSERT(a && b && a->primitives().size() == b->primitives().size());
+        for(int i = 0; i < a->primitives().size(); ++i)
+            CORNU_ASSERT_MSG(a->primitives()[i]->params() == b->primitives()[i]->params(), "Primitive " << i << " differs from an uninterrupted fit");
+    }
+
+    //fitting in small steps should give the same result as fitting in one go
+    void steppingTest()
+    {
+        using Cornu::Debugging; //for CORNU_ASSERT
+
+        Cornu::VectorC<Eigen::Vector2d> pts(60, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i)
+            pts[i] = (i < 40) ? Eigen::Vector2d(4. * i, 0.05 * i * i) : Eigen::Vector2d(160., 80. - 4. * (i - 40));
+
+        Cornu::Fitter fresh;
+        fresh.setDebugging(Debugging::silent());
+        fresh.setOriginalSketch(new Cornu::Polyline(pts));
+        fresh.run();
+
+        Cornu::Fitter stepped, finished;
+        stepped.setDebugging(Debugging::silent());
+        stepped.setOriginalSketch(new Cornu::Polyline(pts));
+        finished.setDebugging(Debugging::silent());
+        finished.setOriginalSketch(new Cornu::Polyline(pts));
+
+        int numSteps = 1;
+        while(!stepped.step(0.)) //a zero budget makes every call do a single step
+            ++numSteps;
+        CORNU_ASSERT_MSG(numSteps > Cornu::NUM_ALGORITHM_STAGES, "Primitive fitting should take several steps");
+
+        int primitiveSteps = 0;
+        while(!finished.output<Cornu::ERROR_COMPUTER>() || primitiveSteps++ < 3)
+            finished.step(0.);
+        CORNU_ASSERT_MSG(!finished.output<Cornu::PRIMITIVE_FITTING>(), "Primitive fitting should be unfinished");
+        finished.run(); //finishes the stage begun by step()
+
+        Cornu::PrimitiveSequenceConstPtr a = stepped.finalOutput(), b = finished.finalOutput(), c = fresh.finalOutput();
+        CORNU_ASSERT(a && b && c && a->primitives().size() == c->primitives().size() && b->primitives().size() == c->primitives().size());
+        for(int i = 0; i < a->primitives().size(); ++i)
+        {
+            CORNU_ASSERT_MSG(a->primitives()[i]->params() == c->primitives()[i]->params(), "Primitive " << i << " differs from an uninterrupted fit");
+            CORNU_ASSERT_MSG(b->primitives()[i]->params() == c->primitives()[i]->params(), "Primitive " << i << " differs from an uninterrupted fit");
+        }
+    }
+
+    void statsTest()
+    {
+        using Cornu::Debugging; //for CORNU_ASSERT
+
+        Cornu::VectorC<Eigen::Vector2d> pts(60, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i)
+            pts[i] = (i < 40) ? Eigen::Vector2d(4. * i, 0.05 * i * i) : Eigen::Vector2d(160., 80. - 4. * (i - 40));
+
+        Cornu::Fitter fitter;
+        fitter.setDebugging(Debugging::silent());
+        fitter.setOriginalSketch(new Cornu::Polyline(pts));
+        fitter.run();
+
+        const Cornu::FitStats &stats = fitter.stats();
+        double total = 0.;
+        for(int i = 0; i < Cornu::NUM_ALGORITHM_STAGES; ++i)
+        {
+            CORNU_ASSERT(stats.stageSeconds[i] >= 0. && stats.stagePeakBytes[i] >= 0);
+            total += stats.stageSeconds[i];
+        }
+        CORNU_ASSERT_MSG(total > 0., "Stage times should be measured");
+        CORNU_ASSERT(stats.resampledPoints > 0 && stats.primitiveCandidates > 0);
+        CORNU_ASSERT(stats.graphVertices > 0 && stats.graphEdges > 0);
+        CORNU_ASSERT(stats.pathFinderIterations > 0 && stats.edgesValidated >= stats.edgesInvalidated);
+        CORNU_ASSERT(stats.solverIterations > 0);
+
+        //after a graph cost change, only the later stages run again
+        int resampledPoints = stats.resampledPoints;
+        Cornu::Parameters params = fitter.params();
+        params.set(Cornu::Parameters::G2_COST, 5.);
+        fitter.setParams(params);
+        fitter.run();
+
+        CORNU_ASSERT_MSG(stats.stageSeconds[Cornu::PRIMITIVE_FITTING] == 0. && stats.stageSeconds[Cornu::GRAPH_CONSTRUCTION] > 0.,
+                         "Only stages that ran should be timed");
+        CORNU_ASSERT_MSG(stats.resampledPoints == resampledPoints, "Counts should come from the reused outputs");
+    }
 };
 
 static EndToEndTest test;
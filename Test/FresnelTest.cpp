@@ -20,6 +20,8 @@
 
 #include "Test.h"
 #include "Fresnel.h"
+#include "FresnelKernels.h"
+#include "Timer.h"
 
 using namespace std;
 using namespace Eigen;
@@ -56,6 +58,81 @@ public:
         Debugging::get()->printf("Done, max relative error = %.10lf", relErr);
 
         CORNU_ASSERT(relErr < 1e-6);
+
+        testKernels(t, 1e-14, 1e-6);
+        testScalar(t);
+
+        //large arguments, including ones past where the integrals are taken to be 1/2
+        VectorXd bigT(100003);
+        for(int i = 0; i < bigT.size(); ++i)
+            bigT[i] = (double(i) / double(bigT.size()) - 0.5) * 100000.;
+        //The scalar versions round pi/2 t^2 before reducing it, which is off by about t * 1e-16 after dividing by pi t,
+        //and the SSE approximation is single precision
+        testKernels(bigT, 1e-11, 1e-3);
+        testScalar(bigT);
+    }
+
+    //Compares every set of kernels the processor supports to the scalar functions and reports their throughput
+    void testKernels(const VectorXd &t, double tol, double approxTol)
+    {
+        const int num = (int)t.size();
+        VectorXd sRef(num), cRef(num), sApproxRef(num), cApproxRef(num);
+        for(int i = 0; i < num; ++i)
+        {
+            fresnel(t[i], &(sRef[i]), &(cRef[i]));
+            fresnelApprox(t[i], &(sApproxRef[i]), &(cApproxRef[i]));
+        }
+
+        VectorXd s(num), c(num);
+        for(int k = 0; k <= fastestFresnelKernels(); ++k)
+        {
+            FresnelKernels kernels = (FresnelKernels)k;
+
+            Timer timer;
+            fresnelMany(kernels, num, t.data(), s.data(), c.data());
+            double elapsed = timer.elapsed();
+            double err = max((s - sRef).cwiseAbs().maxCoeff(), (c - cRef).cwiseAbs().maxCoeff());
+            Debugging::get()->printf("%s double: %.2lf ns per value, max error = %.3lg", fresnelKernelsName(kernels), 1e9 * elapsed / num, err);
+            CORNU_ASSERT_LT_MSG(err, tol, "Vectorized fresnel differs from the scalar one");
+
+            timer.restart();
+            fresnelApproxMany(kernels, num, t.data(), s.data(), c.data());
+            elapsed = timer.elapsed();
+            err = max((s - sApproxRef).cwiseAbs().maxCoeff(), (c - cApproxRef).cwiseAbs().maxCoeff());
+            Debugging::get()->printf("%s approx: %.2lf ns per value, max error = %.3lg", fresnelKernelsName(kernels), 1e9 * elapsed / num, err);
+            CORNU_ASSERT_LT_MSG(err, approxTol, "Vectorized fresnelApprox differs from the scalar one");
+        }
+    }
+
+    //Compares the accuracy and throughput of the three scalar evaluators, taking fresnel as exact
+    void testScalar(const VectorXd &t)
+    {
+        const int num = (int)t.size();
+        VectorXd sRef(num), cRef(num), s(num), c(num);
+
+        for(int method = 0; method < 3; ++method)
+        {
+            const char *names[3] = { "fresnel", "fresnelApprox", "fresnelTable" };
+            VectorXd &outS = (method == 0) ? sRef : s;
+            VectorXd &outC = (method == 0) ? cRef : c;
+
+            Timer timer;
+            for(int i = 0; i < num; ++i)
+            {
+                if(method == 0)
+                    fresnel(t[i], &(outS[i]), &(outC[i]));
+                else if(method == 1)
+                    fresnelApprox(t[i], &(outS[i]), &(outC[i]));
+                else
+                    fresnelTable(t[i], &(outS[i]), &(outC[i]));
+            }
+            double elapsed = timer.elapsed();
+
+            double err = max((outS - sRef).cwiseAbs().maxCoeff(), (outC - cRef).cwiseAbs().maxCoeff());
+            Debugging::get()->printf("%s: %.2lf ns per value, max error = %.3lg", names[method], 1e9 * elapsed / num, err);
+            if(method == 2)
+                CORNU_ASSERT_LT_MSG(err, 5e-12, "fresnelTable is less accurate than documented");
+        }
     }
 
     double f(int i, int num)
@@ -0,0 +1,113 @@
+/*--
+    IncrementalFitterTest.cpp  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Test.h"
+#include "IncrementalFitter.h"
+#include "PrimitiveSequence.h"
+
+using namespace std;
+using namespace Eigen;
+using namespace Cornu;
+
+class IncrementalFitterTest : public TestCase
+{
+public:
+    //override
+    std::string name() { return "IncrementalFitterTest"; }
+
+    //override
+    void run()
+    {
+        circleTest();
+        scribbleTest();
+    }
+
+    void circleTest()
+    {
+        //a long stroke: most of a big circle
+        const int num = 450;
+        const double radius = 300.;
+        VectorC<Vector2d> pts(num, NOT_CIRCULAR);
+        for(int i = 0; i < num; ++i)
+        {
+            double angle = 1.5 * PI * double(i) / double(num - 1);
+            pts[i] = radius * Vector2d(cos(angle), sin(angle));
+        }
+
+        IncrementalFitter fitter;
+        fitter.setDebugging(Debugging::silent());
+
+        int maxWindow = 0, numUpdates = 0, numFailed = 0;
+        for(int i = 0; i < num; ++i)
+        {
+            fitter.addPoint(pts[i]);
+            if(i % 5 != 4 && i != num - 1) //a live preview does not need to update for every point
+                continue;
+            ++numUpdates;
+            if(!fitter.update() && i > 10)
+                ++numFailed;
+            maxWindow = max(maxWindow, i + 1 - fitter.windowStart());
+        }
+
+        PrimitiveSequenceConstPtr output = fitter.update();
+        CORNU_ASSERT_MSG(output, "Incremental fit failed");
+        CORNU_ASSERT_MSG(fitter.committed(), "Nothing was committed");
+        CORNU_ASSERT_LT_MSG(maxWindow, num / 2, "Window does not stay bounded");
+        CORNU_ASSERT_LT_MSG(numFailed, numUpdates / 10, "Too many failed updates");
+
+        //check that the whole stroke is approximated
+        double maxDist = 0;
+        for(int i = 0; i < num; ++i)
+            maxDist = max(maxDist, (output->pos(output->project(pts[i])) - pts[i]).norm());
+        CORNU_ASSERT_LT_MSG(maxDist, 4., "Incremental fit is far from the stroke");
+        CORNU_ASSERT_LT_MSG(fabs(output->length() - radius * 1.5 * PI), 20., "Incremental fit has the wrong length");
+
+        Debugging::get()->printf("Updates = %d, max window = %d points, final primitives = %d", numUpdates, maxWindow, output->primitives().size());
+    }
+
+    void scribbleTest()
+    {
+        //scribbling back and forth: the window keeps coming back over the anchor, so it often doesn't attach to it
+        const int num = 1500;
+        VectorC<Vector2d> pts(num, NOT_CIRCULAR);
+        for(int i = 0; i < num; ++i)
+            pts[i] = Vector2d(100. * sin(0.02 * i), 0.02 * i);
+
+        IncrementalFitter fitter;
+        fitter.setDebugging(Debugging::silent());
+
+        int maxWindow = 0;
+        for(int i = 0; i < num; ++i)
+        {
+            fitter.addPoint(pts[i]);
+            if(i % 5 != 4)
+                continue;
+            PrimitiveSequenceConstPtr output = fitter.update();
+            CORNU_ASSERT_MSG(output || !fitter.committed(), "Committed curve dropped at point " << i);
+            maxWindow = max(maxWindow, i + 1 - fitter.windowStart());
+        }
+
+        CORNU_ASSERT_MSG(fitter.committed(), "Nothing was committed");
+        CORNU_ASSERT_LT_MSG(maxWindow, num / 4, "Window does not stay bounded");
+        Debugging::get()->printf("Scribble max window = %d points", maxWindow);
+    }
+};
+
+static IncrementalFitterTest test;
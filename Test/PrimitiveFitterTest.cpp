@@ -24,6 +24,12 @@
 #include "Line.h"
 #include "Arc.h"
 #include "Clothoid.h"
+#include "Polyline.h"
+#include "Fitter.h"
+#include "Resampler.h"
+#include "ErrorComputer.h"
+#include "StrokeGenerator.h"
+#include "Debugging.h"
 
 #include "Eigen/StdVector"
 
@@ -46,6 +52,12 @@ public:
             testArc();
         for(int i = 0; i < 1000; ++i)
             testClothoid();
+        testPixelScaleClothoid();
+        for(int i = 0; i < 100; ++i)
+            testSpanMoments(i % 2 == 0 ? NOT_CIRCULAR : CIRCULAR);
+        for(int i = 0; i < Algorithm<ERROR_COMPUTER>::numAlgorithmsForStage(ERROR_COMPUTER); ++i)
+            testBoundedError(i);
+        testErrorTracker();
     }
 
     void testLine()
@@ -136,6 +148,180 @@ public:
         ClothoidPtr fitZero = fitter.getCurveWithZeroCurvature(fit->length() * 0.5);
         CORNU_ASSERT_LT_MSG(fabs(fitZero->curvature(fit->length() * 0.5)), 1e-10, "Curvature not zero where expected");
     }
+
+    //At pixel scale, the entries of the clothoid fitter's normal equations (sums of powers of arclength up to the sixth)
+    //span many orders of magnitude, which an explicit inverse of them did not survive under -ffast-math
+    void testPixelScaleClothoid()
+    {
+        ClothoidPtr orig = new Clothoid(Vector2d(100, 50), 0.3, 200., -0.01, 0.02);
+
+        ClothoidFitter fitter;
+        for(int i = 0; i <= 20; ++i)
+        {
+            fitter.addPoint(orig->pos(i * 10.));
+            if(i < 3)
+                continue;
+
+            ClothoidPtr fit = fitter.getCurve();
+            for(int j = 0; j <= i; ++j)
+                CORNU_ASSERT_LT_MSG(fit->distanceTo(orig->pos(j * 10.)), 0.5, "Point " << j << " of " << i + 1 << " too far");
+        }
+
+        //the curvature of the original is zero at a third of its length
+        ClothoidPtr fitZero = fitter.getCurveWithZeroCurvature(200. / 3.);
+        for(int j = 0; j <= 20; ++j)
+            CORNU_ASSERT_LT_MSG(fitZero->distanceTo(orig->pos(j * 10.)), 0.5, "Point " << j << " too far from the constrained fit");
+    }
+
+    //checks the constant time errors of fits to a span against direct summation
+    void testSpanMoments(CircularType circular)
+    {
+        ArcPtr orig = new Arc(Vector2d(drand(100, 500), drand(100, 500)), drand(-PI, PI), drand(100, 500), drand(-0.01, 0.01));
+        const int numPts = 50;
+        VectorC<Vector2d> pts(numPts, circular);
+        for(int i = 0; i < numPts; ++i)
+            pts[i] = orig->pos(double(i) * orig->length() / double(numPts - 1)) + Vector2d(drand(-1, 1), drand(-1, 1));
+        PolylineConstPtr poly = new Polyline(pts);
+        SpanMoments moments(poly);
+
+        int from = rand() % numPts, to = rand() % numPts;
+        if(circular == NOT_CIRCULAR && from > to)
+            swap(from, to);
+        if(from == to)
+            return;
+
+        LineFitter lineFitter;
+        ArcFitter arcFitter;
+        vector<double> weights;
+        for(VectorC<Vector2d>::Circulator circ = pts.circulator(from); ; ++circ)
+        {
+            int idx = circ.index();
+            VectorC<Vector2d>::Circulator prev = --pts.circulator(idx), next = ++pts.circulator(idx);
+            weights.push_back((prev.done() ? 0 : poly->lengthFromTo(prev.index(), idx)) + (next.done() ? 0 : poly->lengthFromTo(idx, next.index())));
+            lineFitter.addPointW(*circ, weights.back());
+            arcFitter.addPointW(*circ, weights.back());
+            if(idx == to)
+                break;
+        }
+
+        LinePtr line = lineFitter.getCurve();
+        ArcPtr arc = arcFitter.getCurve();
+        CurvePrimitiveConstPtr curves[3] = { line, arc, orig };
+        for(int c = 0; c < 3; ++c)
+        {
+            double direct = 0.;
+            for(int i = 0; i < (int)weights.size(); ++i)
+                direct += weights[i] * SQR(SpanMoments::algebraicDistance(*curves[c], pts[from + i]));
+            double error = moments.algebraicError(*curves[c], from, to);
+            CORNU_ASSERT_LT_MSG(fabs(error - direct), 1e-6 * (1. + direct), "Algebraic errors differ " << error << " " << direct);
+        }
+
+        //the algebraic distance is d(1 + kd/2) for a point at distance d from the circle
+        double k = arc->curvature(0);
+        if(fabs(k) < 1e-6)
+            return;
+        for(int i = 0; i < numPts; ++i)
+        {
+            double d = (arc->center() - pts[i]).norm() - fabs(1. / k);
+            double diff = fabs(fabs(SpanMoments::algebraicDistance(*arc, pts[i])) - fabs(d));
+            CORNU_ASSERT_LT_MSG(diff, 0.5 * fabs(k) * SQR(d) + 1e-6, "Algebraic distance off");
+        }
+    }
+
+    void testBoundedError(int algorithm)
+    {
+        StrokeGenerator gen(algorithm + 1);
+        Parameters params;
+        params.setAlgorithm(ERROR_COMPUTER, algorithm);
+
+        Fitter fitter;
+        fitter.setDebugging(Debugging::silent());
+        fitter.setParams(params);
+        fitter.setOriginalSketch(gen.openStroke(100).points);
+        fitter.runUpTo(ERROR_COMPUTER);
+
+        const VectorC<Vector2d> &pts = fitter.output<RESAMPLING>()->output->pts();
+        ErrorComputerConstPtr errorComputer = fitter.output<ERROR_COMPUTER>()->errorComputer;
+
+        for(int i = 0; i < 100; ++i)
+        {
+            int from = rand() % pts.size(), to = rand() % pts.size();
+            if(from > to)
+                swap(from, to);
+            if(to - from < 3)
+                continue;
+
+            LineFitter lineFitter;
+            ArcFitter arcFitter;
+            ClothoidFitter clothoidFitter;
+            for(int j = from; j <= to; ++j)
+            {
+                lineFitter.addPoint(pts[j]);
+                arcFitter.addPoint(pts[j]);
+                clothoidFitter.addPoint(pts[j]);
+            }
+            CurvePrimitiveConstPtr curves[3] = { lineFitter.getPrimitive(), arcFitter.getPrimitive(), clothoidFitter.getPrimitive() };
+
+            for(int type = 0; type < 3; ++type)
+            {
+                bool firstToEndpoint = (i % 2 == 0), lastToEndpoint = (i % 3 == 0);
+                double cost = errorComputer->computeErrorForCost(curves[type], from, to, firstToEndpoint, lastToEndpoint);
+                double bounds[3] = { cost * 0.5, cost, cost * 2. };
+                for(int b = 0; b < 3; ++b)
+                {
+                    double bounded = errorComputer->computeErrorForCostBounded(curves[type], from, to, bounds[b], firstToEndpoint, lastToEndpoint);
+                    if(cost <= bounds[b])
+                    {
+                        CORNU_ASSERT_MSG(bounded == cost, "Bounded cost differs: " << bounded << " vs " << cost << " alg " << algorithm << " type " << type);
+                    }
+                    else
+                    {
+                        CORNU_ASSERT_MSG(bounded > bounds[b], "Bounded cost under the bound: " << bounded << " vs " << bounds[b]);
+                    }
+                }
+            }
+        }
+    }
+
+    void testErrorTracker()
+    {
+        StrokeGenerator::Options options;
+        options.numCorners = 0;
+        options.maxCurvature = 0.005; //so that arcs fit long spans
+        StrokeGenerator gen(5, options);
+
+        Fitter fitter;
+        fitter.setDebugging(Debugging::silent());
+        fitter.setOriginalSketch(gen.openStroke(400).points);
+        fitter.runUpTo(ERROR_COMPUTER);
+
+        const VectorC<Vector2d> &pts = fitter.output<RESAMPLING>()->output->pts();
+        ErrorComputerConstPtr errorComputer = fitter.output<ERROR_COMPUTER>()->errorComputer;
+
+        for(int from = 0; from + 2 < pts.size(); from += 7)
+        {
+            for(int type = 0; type < 3; ++type)
+            {
+                LineFitter lineFitter;
+                ArcFitter arcFitter;
+                ClothoidFitter clothoidFitter;
+                FitterBase *fitters[3] = { &lineFitter, &arcFitter, &clothoidFitter };
+
+                ErrorTrackerPtr tracker = errorComputer->tracker(from);
+                for(int to = from; to < pts.size() && to < from + 80; ++to)
+                {
+                    fitters[type]->addPoint(pts[to]);
+                    if(to < from + 2)
+                        continue;
+                    CurvePrimitiveConstPtr curve = fitters[type]->getPrimitive();
+
+                    double cost = errorComputer->computeErrorForCost(curve, from, to);
+                    double tracked = tracker->computeErrorForCostBounded(curve, to, Parameters::infinity);
+                    CORNU_ASSERT_MSG(tracked == cost, "Tracked cost differs: " << tracked << " vs " << cost << " type " << type);
+                }
+            }
+        }
+    }
 };
 
 static PrimitiveFitterTest test;
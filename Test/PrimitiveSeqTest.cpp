@@ -22,6 +22,10 @@
 
 #include "PrimitiveSequence.h"
 #include "Line.h"
+#include "Arc.h"
+#include "Clothoid.h"
+
+#include "Eigen/StdVector"
 
 using namespace std;
 using namespace Eigen;
@@ -57,6 +61,47 @@ public:
             prims2[i] = new Line(pts2[i], pts2[(i + 1) % 3]);
         
         testPrimitiveSequence(PrimitiveSequence(prims2));
+
+        //sampling
+        VectorC<CurvePrimitiveConstPtr> prims3(4, NOT_CIRCULAR);
+        prims3[0] = new Line(Vector2d(0, 0), Vector2d(10, 0));
+        prims3[1] = new Arc(prims3[0]->endPos(), 0., 30., 0.02);
+        prims3[2] = new Clothoid(prims3[1]->endPos(), prims3[1]->endAngle(), 50., 0.02, -0.05);
+        prims3[3] = new Clothoid(prims3[2]->endPos(), prims3[2]->endAngle(), 1e-3, -0.05, 0.); //shorter than a step
+        for(int i = 0; i < prims3.size(); ++i)
+            testSampling(*prims3[i]);
+        testSampling(PrimitiveSequence(prims3));
+        testSampling(PrimitiveSequence(prims2));
+        testSampling(*ArcPtr(new Arc(Vector2d(0, 0), 1., 40., 1e-8))); //flat
+        testSampling(*ClothoidPtr(new Clothoid(Vector2d(0, 0), 1., 1000., 0.001, 0.05))); //long, anchored many times
+        testSampling(*ClothoidPtr(new Clothoid(Vector2d(0, 0), 1., 20., 1., 3.))); //turns too fast for the recurrence
+    }
+
+    //the fast sampling should agree with evaluating the curve at each sample
+    void testSampling(const Curve &curve)
+    {
+        const double steps[3] = { 0.37, 1., 2.5 };
+        for(int i = 0; i < 3; ++i)
+        {
+            double step = steps[i];
+            vector<Vector2d, Eigen::aligned_allocator<Vector2d> > samples(curve.numUniformSamples(step));
+            curve.sampleUniform(step, &(samples[0]));
+            CORNU_ASSERT_LT_MSG(curve.length() - (samples.size() - 1) * step, step, "Too few uniform samples");
+            for(int j = 0; j < (int)samples.size(); ++j)
+            {
+                CORNU_ASSERT_LT_MSG((samples[j] - curve.pos(j * step)).norm(), 1e-9, "Uniform sample " << j << " is wrong");
+            }
+
+            //from past the start, which closed curves wrap around
+            const int count = 50;
+            Vector2d out[count];
+            double from = curve.isClosed() ? -0.5 * curve.length() : 0.3;
+            curve.samplePositions(from, step, count, out);
+            for(int j = 0; j < count; ++j)
+            {
+                CORNU_ASSERT_LT_MSG((out[j] - curve.pos(from + j * step)).norm(), 1e-9, "Sample " << j << " is wrong");
+            }
+        }
     }
 
     void testPrimitiveSequence(const PrimitiveSequence &p)
@@ -0,0 +1,206 @@
+/*--
+    SolverTest.cpp  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Test.h"
+#include "TestUtils.h"
+#include "Solver.h"
+
+using namespace std;
+using namespace Eigen;
+using namespace Cornu;
+
+//Slightly nonlinear least squares: err_i = a_i . x - b_i + 0.3 sin(c_i . x)
+class ToyResiduals
+{
+public:
+    ToyResiduals(int vars, int terms) : _a(MatrixXd::Random(terms, vars)), _c(MatrixXd::Random(terms, vars)), _b(VectorXd::Random(terms)) {}
+
+    int vars() const { return (int)_a.cols(); }
+
+    void eval(const VectorXd &x, VectorXd &outErr, MatrixXd &outErrDer) const
+    {
+        VectorXd cx = _c * x;
+        outErr = _a * x - _b + 0.3 * cx.array().sin().matrix();
+        outErrDer = _a + 0.3 * cx.array().cos().matrix().asDiagonal() * _c;
+    }
+
+private:
+    MatrixXd _a, _c;
+    VectorXd _b;
+};
+
+class ToyProblem : public LSProblem
+{
+public:
+    ToyProblem(const ToyResiduals &res) : _res(res) {}
+
+    //overrides
+    LSEvalData *createEvalData() { return new LSDenseEvalData(); }
+    void eval(const VectorXd &x, LSEvalData *data)
+    {
+        LSDenseEvalData *denseData = static_cast<LSDenseEvalData *>(data);
+        _res.eval(x, denseData->errVectorRef(), denseData->errDerRef());
+    }
+
+private:
+    const ToyResiduals &_res;
+};
+
+template<int N>
+class ToyProblemFixed : public LSProblemFixed<N>
+{
+public:
+    typedef typename LSProblemFixed<N>::Vec Vec;
+
+    ToyProblemFixed(const ToyResiduals &res) : _res(res) {}
+
+    //overrides
+    double error(const Vec &x) { eval(x, _err, _errDer); return _err.squaredNorm(); }
+    void eval(const Vec &x, VectorXd &outErr, MatrixXd &outErrDer) { _res.eval(x, outErr, outErrDer); }
+
+private:
+    const ToyResiduals &_res;
+    VectorXd _err;
+    MatrixXd _errDer;
+};
+
+class SolverTest : public TestCase
+{
+public:
+    //override
+    std::string name() { return "SolverTest"; }
+
+    //override
+    void run()
+    {
+        srand(5);
+        for(int i = 0; i < 50; ++i)
+        {
+            ToyResiduals res(6, 40);
+
+            vector<LSBoxConstraint> constraints; //at most one per variable, like the fitting code
+            int firstVar = rand() % res.vars(), numConstraints = rand() % 4;
+            for(int j = 0; j < numConstraints; ++j)
+                constraints.push_back(LSBoxConstraint((firstVar + 2 * j) % res.vars(), drand(-0.5, 0.5), rand() % 3 - 1));
+
+            VectorXd guess = VectorXd::Random(res.vars());
+            for(int mode = 0; mode < 3; ++mode) //line search, trust region, trust region with geodesic acceleration
+            {
+                testSolve(res, constraints, guess, 1, mode);
+                testSolve(res, constraints, guess, 5, mode);
+            }
+        }
+
+        //more variables than error terms and no damping: the normal equations are singular
+        ToyResiduals res(6, 4);
+        vector<LSBoxConstraint> constraints;
+        ToyProblemFixed<6> problem(res);
+        LSSolverFixed<6> solver(&problem, constraints);
+        solver.setDefaultDamping(0.);
+        VectorXd x = solver.solve(VectorXd::Zero(6));
+        CORNU_ASSERT_MSG(x.allFinite(), "Singular system not handled");
+        CORNU_ASSERT_LT_MSG(problem.error(x), problem.error(VectorXd::Zero(6)), "Error did not decrease");
+
+        for(int n = 1; n < 8; ++n)
+        {
+            testBlockTridiagonal(n, false);
+            testBlockTridiagonal(n, true);
+        }
+    }
+
+    //compares against a dense solve of the same matrix
+    void testBlockTridiagonal(int n, bool cyclic)
+    {
+        vector<int> offsets(n + 1, 0);
+        for(int i = 0; i < n; ++i)
+            offsets[i + 1] = offsets[i] + 2 + rand() % 6;
+        int size = offsets.back();
+
+        vector<MatrixXd> diagonal(n), offDiagonal(cyclic ? n : n - 1);
+        MatrixXd full = MatrixXd::Zero(size, size);
+        for(int i = 0; i < (int)offDiagonal.size(); ++i)
+        {
+            int next = (i + 1) % n;
+            offDiagonal[i] = MatrixXd::Random(offsets[i + 1] - offsets[i], offsets[next + 1] - offsets[next]);
+            full.block(offsets[i], offsets[next], offDiagonal[i].rows(), offDiagonal[i].cols()) += offDiagonal[i];
+            full.block(offsets[next], offsets[i], offDiagonal[i].cols(), offDiagonal[i].rows()) += offDiagonal[i].transpose();
+        }
+        for(int i = 0; i < n; ++i) //diagonally dominant, so positive definite
+        {
+            int sz = offsets[i + 1] - offsets[i];
+            MatrixXd r = MatrixXd::Random(sz, sz);
+            diagonal[i] = r * r.transpose() + 2. * size * MatrixXd::Identity(sz, sz);
+            full.block(offsets[i], offsets[i], sz, sz) += diagonal[i];
+        }
+
+        MatrixXd rhs = MatrixXd::Random(size, 3);
+        MatrixXd x = BlockTridiagonalSolver(diagonal, offDiagonal, cyclic).solve(rhs);
+        CORNU_ASSERT_LT_MSG((x - full.llt().solve(rhs)).norm(), 1e-10, "Block tridiagonal solve failed for " << n << " blocks, cyclic = " << cyclic);
+    }
+
+    void testSolve(const ToyResiduals &res, const vector<LSBoxConstraint> &constraints, const VectorXd &guess, int maxIter, int mode)
+    {
+        ToyProblem problem(res);
+        LSSolver solver(&problem, constraints);
+        solver.setMaxIter(maxIter);
+        solver.setTrustRegion(mode > 0);
+        solver.setGeodesicAcceleration(mode > 1);
+        VectorXd x = solver.solve(guess);
+
+        ToyProblemFixed<6> problemFixed(res);
+        LSSolverFixed<6> solverFixed(&problemFixed, constraints);
+        solverFixed.setMaxIter(maxIter);
+        solverFixed.setTrustRegion(mode > 0);
+        solverFixed.setGeodesicAcceleration(mode > 1);
+        VectorXd xFixed = solverFixed.solve(guess);
+
+        CORNU_ASSERT_LT_MSG((x - xFixed).norm(), 1e-8, "Fixed solver disagrees after " << maxIter << " iterations in mode " << mode);
+        CORNU_ASSERT(solver.iterations() == solverFixed.iterations());
+        CORNU_ASSERT(solver.halvings() == solverFixed.halvings());
+        CORNU_ASSERT(solver.rejections() == solverFixed.rejections());
+
+        if(mode > 0) //the trust region solver only takes steps that reduce the error
+        {
+            VectorXd clamped = guess;
+            for(int i = 0; i < (int)constraints.size(); ++i)
+            {
+                const LSBoxConstraint &c = constraints[i];
+                if(c.sign == 0 || (clamped[c.index] - c.value) * c.sign < 0.)
+                    clamped[c.index] = c.value;
+            }
+            CORNU_ASSERT_LT_MSG(problemFixed.error(xFixed), problemFixed.error(clamped) + 1e-12, "Trust region step increased the error");
+        }
+
+        for(int i = 0; i < (int)constraints.size(); ++i)
+        {
+            const LSBoxConstraint &c = constraints[i];
+            if(c.sign == 0)
+            {
+                CORNU_ASSERT(fabs(xFixed[c.index] - c.value) < 1e-12);
+            }
+            else
+            {
+                CORNU_ASSERT_LT_MSG(-(xFixed[c.index] - c.value) * c.sign, 1e-12, "Constraint " << i << " violated");
+            }
+        }
+    }
+};
+
+static SolverTest test;
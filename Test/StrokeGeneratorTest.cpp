@@ -0,0 +1,150 @@
+/*--
+    StrokeGeneratorTest.cpp  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Test.h"
+
+#include "StrokeGenerator.h"
+#include "Fitter.h"
+#include "Debugging.h"
+#include "AngleUtils.h"
+
+using namespace std;
+using namespace Eigen;
+using namespace Cornu;
+
+class StrokeGeneratorTest : public TestCase
+{
+public:
+    //override
+    std::string name() { return "StrokeGeneratorTest"; }
+
+    //override
+    void run()
+    {
+        determinismTest();
+        truthTest();
+        noiselessSamplingTest();
+        sizeTest();
+        fitTest();
+    }
+
+    void determinismTest()
+    {
+        StrokeGenerator gen1(7), gen2(7), gen3(8);
+        StrokeGenerator::Stroke s1 = gen1.openStroke(100), s2 = gen2.openStroke(100), s3 = gen3.openStroke(100);
+
+        CORNU_ASSERT(s1.points->pts().size() == s2.points->pts().size());
+        for(int i = 0; i < (int)s1.points->pts().size(); ++i)
+            CORNU_ASSERT(s1.points->pts()[i] == s2.points->pts()[i]);
+        CORNU_ASSERT(s1.points->pts()[0] != s3.points->pts()[0]);
+    }
+
+    void truthTest()
+    {
+        StrokeGenerator gen(1);
+        for(int i = 0; i < 20; ++i)
+        {
+            //without corners, the primitives of an open curve join with continuous tangents
+            PrimitiveSequenceConstPtr open = gen.openCurve(1000.);
+            CORNU_ASSERT_LT_MSG(fabs(open->length() - 1000.), 1e-6, "Wrong length");
+            checkJoints(open);
+
+            PrimitiveSequenceConstPtr closed = gen.closedCurve(1000.);
+            CORNU_ASSERT(closed->isClosed());
+            CORNU_ASSERT_LT_MSG(fabs(closed->length() - 1000.), 1e-6, "Wrong length");
+            checkJoints(closed);
+        }
+    }
+
+    void checkJoints(PrimitiveSequenceConstPtr curve)
+    {
+        const VectorC<CurvePrimitiveConstPtr> &prims = curve->primitives();
+        for(int i = 0; i < prims.endIdx(1); ++i)
+        {
+            CORNU_ASSERT_LT_MSG((prims[i]->endPos() - prims[i + 1]->startPos()).norm(), 1e-6, "Gap at joint " << i);
+            double angleDiff = fabs(AngleUtils::toRange(prims[i]->endAngle() - prims[i + 1]->startAngle(), -PI));
+            CORNU_ASSERT_LT_MSG(angleDiff, 1e-6, "Tangent discontinuity at joint " << i);
+        }
+    }
+
+    void noiselessSamplingTest()
+    {
+        StrokeGenerator::Options options;
+        options.noise = 0.;
+        options.hookProbability = 0.;
+        StrokeGenerator gen(2, options);
+
+        for(int i = 0; i < 5; ++i)
+        {
+            StrokeGenerator::Stroke strokes[2] = { gen.openStroke(200), gen.closedStroke(200) };
+            for(int j = 0; j < 2; ++j)
+            {
+                const VectorC<Vector2d> &pts = strokes[j].points->pts();
+                for(int k = 0; k < (int)pts.size(); ++k)
+                    CORNU_ASSERT_LT_MSG(strokes[j].truth->distanceTo(pts[k]), 1e-4, "Sample off the curve");
+            }
+            //a closed stroke ends where it starts
+            const VectorC<Vector2d> &pts = strokes[1].points->pts();
+            CORNU_ASSERT_LT_MSG((pts[0] - pts[pts.size() - 1]).norm(), 1e-6, "Closed stroke doesn't close");
+        }
+    }
+
+    void sizeTest()
+    {
+        StrokeGenerator gen(3);
+        int sizes[] = { 10, 1000, 100000 };
+        for(int i = 0; i < 3; ++i)
+        {
+            int numPts = (int)gen.openStroke(sizes[i]).points->pts().size();
+            CORNU_ASSERT_MSG(numPts > sizes[i] * 0.7 && numPts < sizes[i] * 1.5 + 10, "Asked for " << sizes[i] << " points, got " << numPts);
+        }
+
+        StrokeGenerator::OversketchPair pair = gen.oversketchPair(300);
+        CORNU_ASSERT(pair.base.points->pts().size() > 100);
+        CORNU_ASSERT(pair.oversketch.points->pts().size() > 100);
+        //the oversketch starts on the base stroke
+        CORNU_ASSERT_LT_MSG(pair.base.truth->distanceTo(pair.oversketch.truth->startPos()), 1e-4, "");
+    }
+
+    void fitTest()
+    {
+        StrokeGenerator::Options options;
+        options.hookProbability = 0.;
+        StrokeGenerator gen(4, options);
+
+        for(int i = 0; i < 5; ++i)
+        {
+            StrokeGenerator::Stroke stroke = gen.openStroke(150);
+
+            Fitter fitter;
+            fitter.setDebugging(Debugging::silent());
+            fitter.setOriginalSketch(stroke.points);
+            fitter.run();
+
+            //the fit stays near the ground truth
+            PrimitiveSequenceConstPtr fit = fitter.finalOutput();
+            CORNU_ASSERT(fit);
+            for(double s = 0; s < fit->length(); s += 1.)
+                CORNU_ASSERT_LT_MSG(stroke.truth->distanceTo(fit->pos(s)), 5., "Stroke " << i);
+        }
+    }
+};
+
+static StrokeGeneratorTest test;
@@ -0,0 +1,186 @@
+/*--
+    ThreadingTest.cpp  
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Test.h"
+#include "Fitter.h"
+#include "Polyline.h"
+#include "PrimitiveSequence.h"
+#include "Threading.h"
+#include "PrimitiveFitter.h"
+#include "StrokeGenerator.h"
+#include "Timer.h"
+
+using namespace std;
+using namespace Eigen;
+using namespace Cornu;
+
+//Fits many strokes on several threads at once, checks that the results are identical to fitting them one at a time,
+//and reports how the throughput scales with the number of threads
+class ThreadingTest : public TestCase
+{
+public:
+    //override
+    std::string name() { return "ThreadingTest"; }
+
+    //override
+    void run()
+    {
+        const int numStrokes = 32;
+        const int repetitions = 3;
+
+        //strokes that every preset can fit, so that the comparison covers complete fits
+        StrokeGenerator::Options options;
+        options.hookProbability = 0.;
+        StrokeGenerator gen(5, options);
+        vector<PolylineConstPtr> strokes;
+        vector<Parameters> params;
+        for(int i = 0; i < numStrokes; ++i)
+        {
+            int numPoints = 30 + (i * 37) % 100;
+            strokes.push_back(i % 4 == 3 ? gen.closedStroke(numPoints).points : gen.openStroke(numPoints).points);
+            params.push_back(Parameters::presets()[i % Parameters::NUM_PRESETS]);
+        }
+
+        vector<PrimitiveSequenceConstPtr> serial(numStrokes);
+        for(int i = 0; i < numStrokes; ++i)
+        {
+            serial[i] = fit(strokes[i], params[i]);
+            CORNU_ASSERT_MSG(serial[i], "Stroke " << i << " (" << params[i].name() << ") failed to fit");
+        }
+
+        //at least 4 threads even on a single processor, so that the threads actually interleave
+        int maxThreads = max(4, Thread::numProcessors());
+        double oneThreadRate = 0.;
+        for(int numThreads = 1; ; numThreads = min(2 * numThreads, maxThreads))
+        {
+            vector<PrimitiveSequenceConstPtr> parallel(numStrokes * repetitions);
+            double rate = parallel.size() / fitOnThreads(strokes, params, parallel, numThreads);
+            if(numThreads == 1)
+                oneThreadRate = rate;
+
+            for(int i = 0; i < (int)parallel.size(); ++i)
+            {
+                PrimitiveSequenceConstPtr a = serial[i % numStrokes], b = parallel[i];
+                CORNU_ASSERT_MSG(b, "Stroke " << i << " failed to fit on " << numThreads << " threads");
+                CORNU_ASSERT_MSG(a->primitives().size() == b->primitives().size(), "Stroke " << i << " primitive counts differ");
+                for(int j = 0; j < a->primitives().size(); ++j)
+                {
+                    CORNU_ASSERT_MSG(a->primitives()[j]->getType() == b->primitives()[j]->getType(), "Stroke " << i << " primitive types differ");
+                    CORNU_ASSERT_MSG(a->primitives()[j]->params() == b->primitives()[j]->params(), "Stroke " << i << " primitive parameters differ");
+                }
+            }
+
+            Debugging::get()->printf("%d threads: %.1lf strokes/s, speedup %.2lf (%d processors)",
+                                     numThreads, rate, rate / oneThreadRate, Thread::numProcessors());
+            if(numThreads == maxThreads)
+                break;
+        }
+
+        parallelStagesTest(strokes, params);
+    }
+
+    //fits every entry of out on numThreads threads and returns the elapsed time in seconds
+    static double fitOnThreads(const vector<PolylineConstPtr> &strokes, const vector<Parameters> &params,
+                               vector<PrimitiveSequenceConstPtr> &out, int numThreads)
+    {
+        Timer timer;
+        vector<FitThread *> threads;
+        for(int i = 0; i < numThreads; ++i)
+            threads.push_back(new FitThread(strokes, params, out, i, numThreads));
+        for(int i = 0; i < numThreads; ++i)
+            threads[i]->start();
+        for(int i = 0; i < numThreads; ++i)
+        {
+            threads[i]->join();
+            delete threads[i];
+        }
+        return timer.elapsed();
+    }
+
+    //fitting one stroke with several threads must produce exactly the same primitives as fitting it with one
+    void parallelStagesTest(const vector<PolylineConstPtr> &strokes, const vector<Parameters> &params)
+    {
+        for(int i = 0; i < (int)strokes.size(); ++i)
+        {
+            Fitter serial, parallel;
+            Fitter *fitters[2] = { &serial, &parallel };
+            for(int j = 0; j < 2; ++j)
+            {
+                fitters[j]->setDebugging(Debugging::silent());
+                fitters[j]->setParams(params[i]);
+                fitters[j]->setOriginalSketch(strokes[i]);
+            }
+            parallel.setNumThreads(4);
+            serial.run();
+            parallel.run();
+
+            const vector<FitPrimitive> &a = serial.output<PRIMITIVE_FITTING>()->primitives;
+            const vector<FitPrimitive> &b = parallel.output<PRIMITIVE_FITTING>()->primitives;
+            CORNU_ASSERT_MSG(a.size() == b.size(), "Stroke " << i << " candidate counts differ");
+            for(int j = 0; j < (int)a.size(); ++j)
+            {
+                CORNU_ASSERT_MSG(a[j].startIdx == b[j].startIdx && a[j].endIdx == b[j].endIdx, "Stroke " << i << " candidates differ");
+                CORNU_ASSERT_MSG(a[j].curve->params() == b[j].curve->params() && a[j].error == b[j].error, "Stroke " << i << " candidates differ");
+            }
+            CORNU_ASSERT_MSG(serial.stats().solverIterations == parallel.stats().solverIterations, "Stroke " << i << " solver counts differ");
+
+            PrimitiveSequenceConstPtr sa = serial.finalOutput(), sb = parallel.finalOutput();
+            CORNU_ASSERT_MSG((sa && sb) || (!sa && !sb), "Stroke " << i << " fit with only one thread count");
+            if(sa)
+                CORNU_ASSERT_MSG(sa->primitives().size() == sb->primitives().size(), "Stroke " << i << " outputs differ");
+        }
+    }
+
+    static PrimitiveSequenceConstPtr fit(PolylineConstPtr stroke, const Parameters &params)
+    {
+        Fitter fitter;
+        fitter.setDebugging(Debugging::silent());
+        fitter.setParams(params);
+        fitter.setOriginalSketch(stroke);
+        fitter.run();
+        return fitter.finalOutput();
+    }
+
+    class FitThread : public Thread
+    {
+    public:
+        FitThread(const vector<PolylineConstPtr> &strokes, const vector<Parameters> &params,
+                  vector<PrimitiveSequenceConstPtr> &out, int first, int step)
+            : _strokes(strokes), _params(params), _out(out), _first(first), _step(step) {}
+
+    protected:
+        //override
+        void run()
+        {
+            for(int i = _first; i < (int)_out.size(); i += _step)
+                _out[i] = fit(_strokes[i % _strokes.size()], _params[i % _strokes.size()]);
+        }
+
+    private:
+        FitThread &operator=(const FitThread &);
+
+        const vector<PolylineConstPtr> &_strokes;
+        const vector<Parameters> &_params;
+        vector<PrimitiveSequenceConstPtr> &_out;
+        int _first, _step;
+    };
+};
+
+static ThreadingTest test;